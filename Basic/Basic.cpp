@@ -12,24 +12,71 @@
 #include "../StanfordCPPLib/strlib.h"
 #include "../StanfordCPPLib/error.h"
 #include "../StanfordCPPLib/tokenscanner.h"
+#include "cemit.h"
 #include "exp.h"
 #include "parser.h"
 #include "program.h"
 #include <cctype>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 using namespace std;
 
 /* Function prototypes */
 
 void processLine(string line, Program &program, EvalState &state);
+bool readExecutionMode(string name, ExecutionMode &mode);
+int emitC(string filename);
 
-/* Main program */
+/*
+ * Main program
+ * ------------
+ * The interpreter accepts the option "--mode tree", "--mode vm",
+ * "--mode threaded", "--mode register" or "--mode jit", which selects
+ * how RUN executes programs by default.  "--report-idioms" makes RUN
+ * list the idioms it fuses on cerr, "--report-superinstructions"
+ * how often each superinstruction of the bytecode VM fired, and
+ * "--report-memory" how much memory the parsed program takes.
+ * "--emit-c file" translates the program in file to C instead of
+ * starting the interpreter.
+ */
 
-int main()
+int main(int argc, char *argv[])
 {
     EvalState state;
     Program program;
+    state.setSymbolTable(&program.getSymbolTable());
+    for (int i = 1; i < argc; i++)
+    {
+        ExecutionMode mode;
+        if (string(argv[i]) == "--mode" && i + 1 < argc && readExecutionMode(argv[i + 1], mode))
+        {
+            state.setExecutionMode(mode);
+            i++;
+        }
+        else if (string(argv[i]) == "--report-idioms")
+        {
+            state.setReportingIdioms(true);
+        }
+        else if (string(argv[i]) == "--report-superinstructions")
+        {
+            state.setReportingSuperinstructions(true);
+        }
+        else if (string(argv[i]) == "--report-memory")
+        {
+            state.setReportingMemory(true);
+        }
+        else if (string(argv[i]) == "--emit-c" && i + 1 < argc)
+        {
+            return emitC(argv[i + 1]);
+        }
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--mode tree|vm|threaded|register|jit] [--report-idioms] [--report-superinstructions] [--report-memory] [--emit-c file]" << endl;
+            return 1;
+        }
+    }
     while (true)
     {
         try
@@ -84,67 +131,140 @@ void processLine(string line, Program &program, EvalState &state)
         string CommandType = first;
         if (CommandType == "LET")
         {
-            Expression *exp = parseExp(scanner);
+            Arena arena;
+            Expression *exp = parseExp(scanner, program.getSymbolTable(), arena);
             if (exp->getType() != COMPOUND)
             {
                 cout << "SYNTAX ERROR" << endl;
             }
             SeqLET aLET = SeqLET(exp);
             aLET.execute(state);
-            if (!exp)
-                delete exp;
         }
         else if (CommandType == "PRINT")
         {
-            Expression *exp = parseExp(scanner);
+            Arena arena;
+            Expression *exp = parseExp(scanner, program.getSymbolTable(), arena);
             SeqPRINT aPRINT = SeqPRINT(exp);
             aPRINT.execute(state);
-            if (!exp)
-                delete exp;
         }
         else if (CommandType == "INPUT")
         {
             string var = scanner.nextToken();
-            SeqINPUT aINPUT = SeqINPUT(var);
+            SeqINPUT aINPUT = SeqINPUT(var, program.getSymbolTable().intern(var));
             aINPUT.execute(state);
             return;
         }
         else if (CommandType == "RUN")
         {
-            Program *p = &program;
-            CommandRUN run = CommandRUN(p);
+            ExecutionMode mode = state.getExecutionMode();
+            readExecutionMode(toLowerCase(scanner.nextToken()), mode);
+            CommandRUN run = CommandRUN(&program, mode);
             run.execute(state, program);
-            if (!p)
-                delete p;
         }
         else if (CommandType == "LIST")
         {
-            Program *p = &program;
-            CommandLIST list = CommandLIST(p);
+            CommandLIST list = CommandLIST(&program);
             list.execute(state, program);
-            if (!p)
-                delete p;
         }
         else if (CommandType == "CLEAR")
         {
-            Program *p = &program;
-            CommandCLEAR clear = CommandCLEAR(p);
+            CommandCLEAR clear = CommandCLEAR(&program);
             clear.execute(state, program);
-            if (!p)
-                delete p;
         }
         else if (CommandType == "QUIT")
         {
-            Program *p = &program;
             CommandQUIT quit = CommandQUIT();
             quit.execute(state, program);
-            if (!p)
-                delete p;
         }
         else if (CommandType == "HELP")
         {
             CommandHELP help = CommandHELP();
             help.execute(state, program);
         }
+        else if (CommandType == "CHECK")
+        {
+            CommandCHECK check = CommandCHECK();
+            check.execute(state, program);
+        }
     }
-}
\ No newline at end of file
+}
+
+/*
+ * Function: readExecutionMode
+ * Usage: if (readExecutionMode(name, mode)) . . .
+ * -----------------------------------------------
+ * Sets mode to the execution mode called name ("tree", "vm",
+ * "threaded", "register" or "jit") and returns true, or returns false if there is no such
+ * mode.  RUN also accepts the mode as an argument, as in "RUN TREE".
+ */
+
+bool readExecutionMode(string name, ExecutionMode &mode)
+{
+    if (name == "tree")
+        mode = TREE_WALKER;
+    else if (name == "vm")
+        mode = BYTECODE_VM;
+    else if (name == "threaded")
+        mode = THREADED_VM;
+    else if (name == "register")
+        mode = REGISTER_VM;
+    else if (name == "jit")
+        mode = NATIVE_JIT;
+    else
+        return false;
+    return true;
+}
+
+/*
+ * Function: emitC
+ * Usage: return emitC(filename);
+ * ------------------------------
+ * Reads the numbered lines of a BASIC file, up to the first RUN
+ * command, and writes the program as C to cout.  Other commands are
+ * ignored, and messages about bad lines go to cerr so that they do not
+ * end up in the translation.  Returns the exit status for main.
+ */
+
+int emitC(string filename)
+{
+    ifstream in(filename.c_str());
+    if (in.fail())
+    {
+        cerr << "Can't open " << filename << endl;
+        return 1;
+    }
+    Program program;
+    streambuf *output = cout.rdbuf(cerr.rdbuf());
+    string line;
+    while (getline(in, line))
+    {
+        TokenScanner scanner(line);
+        scanner.ignoreWhitespace();
+        scanner.scanNumbers();
+        string first = scanner.nextToken();
+        if (first == "RUN")
+            break;
+        if (first.empty() || first.find_first_not_of("0123456789") != string::npos)
+            continue;
+        stringstream ss(first);
+        int lineNumber;
+        ss >> lineNumber;
+        try
+        {
+            program.addSourceLine(lineNumber, line, scanner);
+        }
+        catch (ErrorException &ex)
+        {
+            cerr << "Error: " << ex.getMessage() << endl;
+        }
+    }
+    cout.rdbuf(output);
+    if (program.getFirstLineNumber() == -1)
+    {
+        cerr << filename << " contains no program" << endl;
+        return 1;
+    }
+    CEmitter emitter(cout);
+    emitter.emit(program);
+    return 0;
+}
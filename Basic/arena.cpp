@@ -0,0 +1,97 @@
+/*
+ * File: arena.cpp
+ * ---------------
+ * This file implements the arena.h interface.
+ */
+
+#include "arena.h"
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+/*
+ * Implementation notes: the Arena class
+ * -------------------------------------
+ * The arena carves memory out of [cursor, limit), starting in the
+ * inline block.  Each allocation is rounded up to ALIGNMENT, and one
+ * with a destroy function is preceded by a Header.  The headers form a
+ * list from last back to the first such allocation.  Deleting the arena walks that list
+ * calling destroy and then frees the heap blocks.
+ */
+
+Arena::Arena()
+{
+    last = NULL;
+    blocks = NULL;
+    cursor = (char *)first;
+    limit = cursor + INLINE_SIZE;
+    used = 0;
+    blockSize = INLINE_SIZE;
+}
+
+Arena::~Arena()
+{
+    for (Header *header = last; header != NULL; header = header->prev)
+    {
+        if (header->destroy != NULL)
+            header->destroy(header + 1);
+    }
+    while (blocks != NULL)
+    {
+        Block *next = blocks->next;
+        std::free(blocks);
+        blocks = next;
+    }
+}
+
+void *Arena::allocate(size_t size, void (*destroy)(void *))
+{
+    size_t total = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (destroy != NULL)
+        total += sizeof(Header);
+    char *ptr = cursor;
+    if ((size_t)(limit - cursor) < total)
+        ptr = grow(total);
+    cursor = ptr + total;
+    used += total;
+    if (destroy == NULL)
+        return ptr;
+    Header *header = (Header *)ptr;
+    header->prev = last;
+    header->destroy = destroy;
+    last = header;
+    return header + 1;
+}
+
+void Arena::release(void *ptr)
+{
+    ((Header *)ptr - 1)->destroy = NULL;
+}
+
+size_t Arena::getBytesUsed()
+{
+    return used;
+}
+
+/*
+ * Implementation notes: grow
+ * --------------------------
+ * Starts a new block that holds at least size bytes.  The rest of the
+ * current block is abandoned; blocks double in size, so that waste is
+ * bounded by the memory already in use.
+ */
+
+char *Arena::grow(size_t size)
+{
+    blockSize *= 2;
+    while (blockSize < size)
+        blockSize *= 2;
+    Block *block = (Block *)std::malloc(sizeof(Block) + blockSize);
+    if (block == NULL)
+        throw bad_alloc();
+    block->next = blocks;
+    blocks = block;
+    cursor = (char *)(block + 1);
+    limit = cursor + blockSize;
+    return cursor;
+}
@@ -0,0 +1,122 @@
+/*
+ * File: arena.h
+ * -------------
+ * This interface exports the Arena class, a bump allocator that holds
+ * the parsed statement and expression nodes of one program line.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <cstddef>
+using namespace std;
+
+/*
+ * Class: Arena
+ * ------------
+ * This class hands out memory by advancing a pointer through a block,
+ * so the nodes allocated in one arena lie next to each other in the
+ * order they were made.  Nodes are never freed one by one: deleting
+ * the arena runs the destructors of everything allocated in it, newest
+ * first, and releases all of its memory at once.
+ *
+ * The first block is part of the Arena object itself and is large
+ * enough for a typical line, so a line costs a single heap allocation.
+ * Longer lines chain further blocks, each at least twice the size of
+ * the one before.
+ */
+
+class Arena
+{
+
+public:
+  /*
+ * Constructor: Arena
+ * Usage: Arena *arena = new Arena();
+ * ----------------------------------
+ * Creates an empty arena.
+ */
+
+  Arena();
+
+  /*
+ * Destructor: ~Arena
+ * Usage: delete arena;
+ * --------------------
+ * Destroys every object allocated in the arena and frees its blocks.
+ */
+
+  ~Arena();
+
+  /*
+ * Method: allocate
+ * Usage: void *ptr = arena.allocate(size, destroy);
+ * -------------------------------------------------
+ * Returns size bytes of memory aligned for any node.  Unless destroy
+ * is NULL, the arena calls it on the returned address when it is
+ * deleted, which is how the nodes built there get destroyed.  An
+ * object with no destroy function costs only its own size.
+ */
+
+  void *allocate(size_t size, void (*destroy)(void *));
+
+  /*
+ * Method: release
+ * Usage: arena.release(ptr);
+ * --------------------------
+ * Cancels the destroy call registered for ptr, for an object whose
+ * constructor threw.  ptr must have been allocated with a destroy
+ * function.  Its memory stays in the arena until the arena
+ * is deleted.
+ */
+
+  void release(void *ptr);
+
+  /*
+ * Method: getBytesUsed
+ * Usage: size_t bytes = arena.getBytesUsed();
+ * -------------------------------------------
+ * Returns the number of bytes handed out so far, including the
+ * bookkeeping kept in front of the objects that have a destroy
+ * function.
+ */
+
+  size_t getBytesUsed();
+
+private:
+  static const size_t ALIGNMENT = sizeof(long long);
+  static const size_t INLINE_SIZE = 512;
+
+  /*
+   * Each allocation with a destroy function is preceded by a Header
+   * that links it to the one before, so the destructor can walk those
+   * objects newest first.  A Block is a heap block chained after the
+   * inline one.
+   */
+
+  struct Header
+  {
+    Header *prev;
+    void (*destroy)(void *);
+  };
+
+  struct Block
+  {
+    Block *next;
+  };
+
+  Arena(const Arena &);
+  Arena &operator=(const Arena &);
+
+  char *grow(size_t size);
+
+  Header *last;
+  Block *blocks;
+  char *cursor;
+  char *limit;
+  size_t used;
+  size_t blockSize;
+  long long first[INLINE_SIZE / ALIGNMENT];
+};
+
+#endif
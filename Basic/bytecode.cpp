@@ -0,0 +1,121 @@
+/*
+ * File: bytecode.cpp
+ * ------------------
+ * This file implements the Bytecode class.
+ */
+
+#include "bytecode.h"
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Implementation notes: the Bytecode class
+ * ----------------------------------------------
+ * Instructions are kept in a vector so that the VM can walk them
+ * through a plain pointer.
+ */
+
+Bytecode::Bytecode()
+{
+    maxStackDepth = 0;
+}
+
+int Bytecode::emit(int op, int arg)
+{
+    Instruction ins;
+    ins.op = op;
+    ins.arg = arg;
+    code.push_back(ins);
+    return code.size() - 1;
+}
+
+void Bytecode::patch(int pc, int arg)
+{
+    code[pc].arg = arg;
+}
+
+int Bytecode::size()
+{
+    return code.size();
+}
+
+void Bytecode::setLineAddress(int line, int pc)
+{
+    lines[line] = pc;
+}
+
+int Bytecode::getLineAddress(int line)
+{
+    map<int, int>::iterator it = lines.find(line);
+    if (it == lines.end())
+        return -1;
+    return it->second;
+}
+
+void Bytecode::noteStackDepth(int depth)
+{
+    if (depth > maxStackDepth)
+        maxStackDepth = depth;
+}
+
+int Bytecode::getMaxStackDepth()
+{
+    return maxStackDepth;
+}
+
+Instruction *Bytecode::getInstructions()
+{
+    return &code[0];
+}
+
+int Bytecode::addClosedForm(ClosedForm *form)
+{
+    closedForms.push_back(form);
+    return closedForms.size() - 1;
+}
+
+ClosedForm *Bytecode::getClosedForm(int k)
+{
+    return closedForms[k];
+}
+
+/*
+ * Implementation notes: fuse
+ * --------------------------
+ * Sequences are matched against a copy of the original code, so that
+ * an increment followed by a compare-and-jump is recognized even
+ * though the compare has been fused on its own as well.  The longer
+ * sequence is tried first.
+ */
+
+void Bytecode::fuse()
+{
+    vector<Instruction> original = code;
+    int n = original.size();
+    for (int pc = 0; pc < n; pc++)
+    {
+        const Instruction *ins = &original[pc];
+        bool inc = pc + 4 < n && ins[0].op == OP_LOAD_DEFINED && ins[1].op == OP_CONST && ins[2].op == OP_ADD && ins[3].op == OP_STORE && ins[3].arg == ins[0].arg && ins[4].op == OP_POP;
+        int first = inc ? pc + 5 : pc;
+        int compare = -1;
+        if (first + 2 < n && original[first].op == OP_LOAD_DEFINED)
+        {
+            const Instruction *cmp = &original[first];
+            bool jump = cmp[2].op == OP_JUMP_GT || cmp[2].op == OP_JUMP_LT || cmp[2].op == OP_JUMP_EQ;
+            if (jump && cmp[1].op == OP_CONST)
+                compare = OP_JUMP_GT_CONST + cmp[2].op - OP_JUMP_GT;
+            else if (jump && cmp[1].op == OP_LOAD_DEFINED)
+                compare = OP_JUMP_GT_VAR + cmp[2].op - OP_JUMP_GT;
+        }
+        if (inc && compare >= 0)
+            code[pc].op = compare - OP_JUMP_GT_CONST + OP_INC_JUMP_GT_CONST;
+        else if (inc)
+            code[pc].op = OP_INC;
+        else if (compare >= 0)
+            code[pc].op = compare;
+        else if (pc + 2 < n && ins[0].op == OP_CONST && ins[1].op == OP_STORE && ins[2].op == OP_POP)
+            code[pc].op = OP_STORE_CONST;
+    }
+}
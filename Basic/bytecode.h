@@ -0,0 +1,248 @@
+/*
+ * File: bytecode.h
+ * ----------------
+ * This interface defines the instruction set of the bytecode VM and
+ * the Bytecode class, which holds a whole BASIC program lowered into
+ * a flat array of instructions.
+ */
+
+#ifndef _bytecode_h
+#define _bytecode_h
+
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+class ClosedForm;
+
+/*
+ * Type: Opcode
+ * ------------
+ * This enumerated type lists the instructions of the stack VM.  Every
+ * expression leaves its value on the operand stack and its flag (the
+ * one returned by Expression::eval) in the flag register of the VM.
+ *
+ *  OP_CONST k        -- push the constant k, flag = 1
+ *  OP_LOAD v         -- push variable v, or report VARIABLE NOT DEFINED
+ *  OP_LOAD_DEFINED v -- push variable v, which is known to be defined
+ *  OP_STORE v        -- store the top of stack into v, flag = 1
+ *  OP_BAD_ASSIGN     -- report SYNTAX ERROR for "=" without a variable
+ *  OP_ADD .. OP_DIV  -- pop two operands and push the result
+ *  OP_DIV_NONZERO    -- OP_DIV for a divisor known not to be zero
+ *  OP_REM            -- pop p and q and push q - q / p * p, or report
+ *                       DIVIDE BY ZERO and push q, flag = 1
+ *  OP_BAD_OP         -- pop two operands and report SYNTAX ERROR
+ *  OP_POP            -- discard the top of stack
+ *  OP_PRINT          -- pop a value and print it if the flag is set
+ *  OP_INPUT v        -- read an integer from the user into v
+ *  OP_ABS v          -- replace variable v by its absolute value
+ *  OP_MAX v          -- pop x and store it into v if x > v
+ *  OP_MIN v          -- pop x and store it into v if x < v
+ *  OP_GCD t          -- run Euclid's algorithm on the top two values a
+ *                       and b, replacing them by the final a and b and
+ *                       storing the last remainder into t if it ran
+ *  OP_CLOSED_FORM k  -- run closed form k on the variables
+ *  OP_JUMP pc        -- continue execution at pc
+ *  OP_JUMP_GT pc     -- pop rhs and lhs, jump to pc if lhs > rhs
+ *  OP_JUMP_LT pc     -- pop rhs and lhs, jump to pc if lhs < rhs
+ *  OP_JUMP_EQ pc     -- pop rhs and lhs, jump to pc if lhs == rhs
+ *  OP_BAD_CMP        -- pop both operands and report SYNTAX ERROR
+ *  OP_LINE_ERROR     -- report LINE NUMBER ERROR
+ *  OP_NOT_COMPOUND   -- report that LET expects a compound expression
+ *  OP_HALT           -- stop the program
+ *
+ * The superinstructions below are never emitted by the compiler; fuse
+ * puts them in place of the first instruction of a common sequence.
+ * The rest of the sequence is left as it was and holds the operands,
+ * so a jump into the middle of it still runs the original code.  Each
+ * one does exactly what its sequence does, flag included, and then
+ * skips past it.
+ *
+ *  OP_STORE_CONST k  -- CONST k; STORE v; POP, with v in the next cell
+ *  OP_INC v          -- LOAD_DEFINED v; CONST k; ADD; STORE v; POP,
+ *                       with k in the next cell
+ *  OP_JUMP_GT_CONST v,
+ *  OP_JUMP_LT_CONST v,
+ *  OP_JUMP_EQ_CONST v -- LOAD_DEFINED v; CONST k; JUMP_xx pc
+ *  OP_JUMP_GT_VAR v,
+ *  OP_JUMP_LT_VAR v,
+ *  OP_JUMP_EQ_VAR v  -- LOAD_DEFINED v; LOAD_DEFINED w; JUMP_xx pc
+ *  OP_INC_JUMP_GT_CONST v .. OP_INC_JUMP_EQ_VAR v
+ *                    -- an OP_INC sequence followed by the sequence of
+ *                       the corresponding compare-and-jump
+ *  OP_COUNT          -- the number of opcodes, not an instruction
+ */
+
+enum Opcode
+{
+  OP_CONST,
+  OP_LOAD,
+  OP_LOAD_DEFINED,
+  OP_STORE,
+  OP_BAD_ASSIGN,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_DIV_NONZERO,
+  OP_REM,
+  OP_BAD_OP,
+  OP_POP,
+  OP_PRINT,
+  OP_INPUT,
+  OP_ABS,
+  OP_MAX,
+  OP_MIN,
+  OP_GCD,
+  OP_CLOSED_FORM,
+  OP_JUMP,
+  OP_JUMP_GT,
+  OP_JUMP_LT,
+  OP_JUMP_EQ,
+  OP_BAD_CMP,
+  OP_LINE_ERROR,
+  OP_NOT_COMPOUND,
+  OP_HALT,
+  OP_STORE_CONST,
+  OP_INC,
+  OP_JUMP_GT_CONST,
+  OP_JUMP_LT_CONST,
+  OP_JUMP_EQ_CONST,
+  OP_JUMP_GT_VAR,
+  OP_JUMP_LT_VAR,
+  OP_JUMP_EQ_VAR,
+  OP_INC_JUMP_GT_CONST,
+  OP_INC_JUMP_LT_CONST,
+  OP_INC_JUMP_EQ_CONST,
+  OP_INC_JUMP_GT_VAR,
+  OP_INC_JUMP_LT_VAR,
+  OP_INC_JUMP_EQ_VAR,
+  OP_COUNT
+};
+
+/*
+ * Type: Instruction
+ * -----------------
+ * A single VM instruction: an opcode and its integer operand, which
+ * is a constant, a variable slot or a jump target depending on op.
+ */
+
+struct Instruction
+{
+  int op;
+  int arg;
+};
+
+/*
+ * Class: Bytecode
+ * ---------------
+ * This class stores a compiled program: the instruction array and
+ * the address of each line.  Variables are referred to by the slots
+ * of the program's SymbolTable.
+ */
+
+class Bytecode
+{
+
+public:
+  /*
+ * Constructor: Bytecode
+ * Usage: Bytecode code;
+ * -----------------------
+ * Creates an empty program.
+ */
+
+  Bytecode();
+
+  /*
+ * Method: emit
+ * Usage: int pc = code.emit(op, arg);
+ * -----------------------
+ * Appends an instruction and returns its address.
+ */
+
+  int emit(int op, int arg = 0);
+
+  /*
+ * Method: patch
+ * Usage: code.patch(pc, arg);
+ * -----------------------
+ * Replaces the operand of the instruction at pc.
+ */
+
+  void patch(int pc, int arg);
+
+  /*
+ * Method: size
+ * Usage: int n = code.size();
+ * -----------------------
+ * Returns the number of instructions, which is also the address of
+ * the next instruction to be emitted.
+ */
+
+  int size();
+
+  /*
+ * Methods: setLineAddress, getLineAddress
+ * Usage: code.setLineAddress(line, pc);
+ *        int pc = code.getLineAddress(line);
+ * -----------------------
+ * Records or looks up the address of the first instruction of a line.
+ * getLineAddress returns -1 if the line was not compiled.
+ */
+
+  void setLineAddress(int line, int pc);
+  int getLineAddress(int line);
+
+  /*
+ * Methods: noteStackDepth, getMaxStackDepth
+ * Usage: code.noteStackDepth(depth);
+ *        int depth = code.getMaxStackDepth();
+ * -----------------------
+ * Keeps track of the deepest operand stack the program needs.
+ */
+
+  void noteStackDepth(int depth);
+  int getMaxStackDepth();
+
+  /*
+ * Method: getInstructions
+ * Usage: Instruction *code = bytecode.getInstructions();
+ * -----------------------
+ * Returns a pointer to the first instruction of the flat array.
+ */
+
+  Instruction *getInstructions();
+
+  /*
+ * Methods: addClosedForm, getClosedForm
+ * Usage: int k = code.addClosedForm(form);
+ *        ClosedForm *form = code.getClosedForm(k);
+ * -----------------------
+ * Numbers the closed forms that OP_CLOSED_FORM refers to.  The forms
+ * belong to the LoopInvariants the program was compiled with.
+ */
+
+  int addClosedForm(ClosedForm *form);
+  ClosedForm *getClosedForm(int k);
+
+  /*
+ * Method: fuse
+ * Usage: code.fuse();
+ * -----------------------
+ * Replaces the first instruction of every sequence in the catalogue of
+ * superinstructions by the superinstruction.  Since nothing moves, it
+ * can run once every jump has been patched.
+ */
+
+  void fuse();
+
+private:
+  vector<Instruction> code;
+  vector<ClosedForm *> closedForms;
+  map<int, int> lines;
+  int maxStackDepth;
+};
+
+#endif
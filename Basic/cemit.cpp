@@ -0,0 +1,419 @@
+/*
+ * File: cemit.cpp
+ * ---------------
+ * This file implements the CEmitter class.
+ */
+
+#include "cemit.h"
+#include "cfg.h"
+#include "copies.h"
+#include "defined.h"
+#include "exp.h"
+#include "program.h"
+#include "range.h"
+#include "statement.h"
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+using namespace std;
+
+/*
+ * Constant: RUNTIME
+ * -----------------
+ * The runtime support written at the top of every translation.  input
+ * reads a line and parses it the way readInputValue does with a
+ * stringstream: an optional sign and decimal digits, surrounded only
+ * by whitespace and within the range of int.  The functions are not
+ * static, so that a program which never calls one does not warn.
+ */
+
+static const char *RUNTIME =
+    "#include <ctype.h>\n"
+    "#include <errno.h>\n"
+    "#include <limits.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "int flag = 1;\n"
+    "\n"
+    "void report(const char *message)\n"
+    "{\n"
+    "    puts(message);\n"
+    "}\n"
+    "\n"
+    "int check(int defined)\n"
+    "{\n"
+    "    if (!defined)\n"
+    "        puts(\"VARIABLE NOT DEFINED\");\n"
+    "    return defined;\n"
+    "}\n"
+    "\n"
+    "void print(int value)\n"
+    "{\n"
+    "    printf(\"%d\\n\", value);\n"
+    "}\n"
+    "\n"
+    "int parse(const char *s, int *value)\n"
+    "{\n"
+    "    char *end;\n"
+    "    long n;\n"
+    "    while (isspace((unsigned char)*s))\n"
+    "        s++;\n"
+    "    if (!isdigit((unsigned char)s[0]) && !((s[0] == '+' || s[0] == '-') && isdigit((unsigned char)s[1])))\n"
+    "        return 0;\n"
+    "    errno = 0;\n"
+    "    n = strtol(s, &end, 10);\n"
+    "    if (errno == ERANGE || n < INT_MIN || n > INT_MAX)\n"
+    "        return 0;\n"
+    "    while (isspace((unsigned char)*end))\n"
+    "        end++;\n"
+    "    if (*end != '\\0')\n"
+    "        return 0;\n"
+    "    *value = (int)n;\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "int input(void)\n"
+    "{\n"
+    "    static char *line = NULL;\n"
+    "    static size_t capacity = 0;\n"
+    "    int value;\n"
+    "    while (1)\n"
+    "    {\n"
+    "        size_t length = 0;\n"
+    "        int c;\n"
+    "        fputs(\" ? \", stdout);\n"
+    "        fflush(stdout);\n"
+    "        while ((c = getchar()) != EOF && c != '\\n')\n"
+    "        {\n"
+    "            if (length + 1 >= capacity)\n"
+    "            {\n"
+    "                capacity = capacity * 2 + 64;\n"
+    "                line = (char *)realloc(line, capacity);\n"
+    "            }\n"
+    "            line[length++] = (char)c;\n"
+    "        }\n"
+    "        if (line != NULL)\n"
+    "            line[length] = '\\0';\n"
+    "        if (line != NULL && parse(line, &value))\n"
+    "            return value;\n"
+    "        puts(\"INVALID NUMBER\");\n"
+    "    }\n"
+    "}\n"
+    "\n";
+
+CEmitter::CEmitter(ostream &out) : out(out)
+{
+    variableCount = 0;
+    reservedCount = 0;
+    temporaryCount = 0;
+    flagKnown = true;
+}
+
+/*
+ * Implementation notes: emit
+ * --------------------------
+ * The body of main is generated first, since the number of
+ * temporaries is only known afterwards.  Variables live in the arrays
+ * v and d, indexed by SymbolTable slot, and the intermediate results
+ * of expressions in the locals t0, t1, ...  As the translation starts
+ * with no variable defined, the definedness analysis runs first and
+ * the reads it proves need no check; copy propagation and dead-store
+ * elimination follow, and the dead stores are not translated.
+ */
+
+void CEmitter::emit(Program &program)
+{
+    program.link();
+    variableCount = program.getSymbolTable().size();
+    reservedCount = program.getSymbolTable().getReservedCount();
+    ControlFlowGraph cfg(program);
+    clearCopies(cfg);
+    analyzeDefinedness(cfg, vector<bool>(variableCount, false), reservedCount);
+    propagateCopies(cfg, variableCount, reservedCount);
+    eliminateDeadStores(cfg, variableCount, reservedCount);
+    RangeAnalysis ranges(cfg, vector<bool>(variableCount, false), vector<int>(variableCount, 0), reservedCount);
+    temporaryCount = 0;
+    body.str("");
+
+    set<Statement *> targets;
+    Statement *first = program.getLinkedStatement(program.getFirstLineNumber());
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        if (stmt->getType() == GOTO && ((ControlGOTO *)stmt)->getTarget() != NULL)
+            targets.insert(((ControlGOTO *)stmt)->getTarget());
+        if (stmt->getType() == IF && ((ControlIF *)stmt)->getTarget() != NULL)
+            targets.insert(((ControlIF *)stmt)->getTarget());
+    }
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        string source = program.getSourceLine(stmt->getLineNumber());
+        size_t pos;
+        while ((pos = source.find("*/")) != string::npos)
+            source.replace(pos, 2, "* /");
+        body << "    /* " << source << " */" << endl;
+        if (targets.count(stmt) != 0)
+            body << label(stmt) << ":" << endl;
+        emitStatement(stmt);
+    }
+
+    out << RUNTIME;
+    out << "int v[" << variableCount << "];" << endl;
+    out << "int d[" << variableCount << "];" << endl;
+    out << endl;
+    for (int i = reservedCount; i < variableCount; i++)
+        out << "/* " << variable(i) << " is " << program.getSymbolTable().getName(i) << " */" << endl;
+    if (variableCount > reservedCount)
+        out << endl;
+    out << "int main(void)" << endl;
+    out << "{" << endl;
+    for (int i = 0; i < temporaryCount; i++)
+        out << "    int t" << i << ";" << endl;
+    out << body.str();
+    out << "    return 0;" << endl;
+    out << "}" << endl;
+}
+
+void CEmitter::emitStatement(Statement *stmt)
+{
+    switch (stmt->getType())
+    {
+    case REM:
+        break;
+    case LET:
+    {
+        if (((SeqLET *)stmt)->isDead())
+            break;
+        Expression *exp = ((SeqLET *)stmt)->getExp();
+        if (exp->getType() != COMPOUND)
+            body << "    report(\"Compund expression expected\");" << endl;
+        int slot;
+        emitExp(exp, 0, slot);
+        break;
+    }
+    case PRINT:
+    {
+        int slot;
+        string value = emitExp(((SeqPRINT *)stmt)->getExp(), 0, slot);
+        if (flagKnown)
+            body << "    print(" << value << ");" << endl;
+        else
+            body << "    if (flag)" << endl
+                 << "        print(" << value << ");" << endl;
+        break;
+    }
+    case INPUT:
+    {
+        int slot = ((SeqINPUT *)stmt)->getSlot();
+        if (slot < reservedCount)
+            body << "    input();" << endl
+                 << "    report(\"SYNTAX ERROR\");" << endl;
+        else
+            body << "    " << variable(slot) << " = input();" << endl
+                 << "    " << defined(slot) << " = 1;" << endl;
+        break;
+    }
+    case END:
+        body << "    return 0;" << endl;
+        break;
+    case GOTO:
+    {
+        Statement *target = ((ControlGOTO *)stmt)->getTarget();
+        if (target != NULL)
+            body << "    goto " << label(target) << ";" << endl;
+        else
+            body << "    report(\"LINE NUMBER ERROR\");" << endl;
+        break;
+    }
+    case IF:
+    {
+        ControlIF *ctrl = (ControlIF *)stmt;
+        int slot;
+        string lhs = emitExp(ctrl->getLHS(), 0, slot);
+        if (slot >= 0 && assignsTo(ctrl->getRHS(), slot))
+        {
+            if (temporaryCount == 0)
+                temporaryCount = 1;
+            body << "    t0 = " << lhs << ";" << endl;
+            lhs = "t0";
+        }
+        string rhs = emitExp(ctrl->getRHS(), 1, slot);
+        string cmp;
+        switch (ctrl->getCmp())
+        {
+        case '>':
+            cmp = ">";
+            break;
+        case '<':
+            cmp = "<";
+            break;
+        case '=':
+            cmp = "==";
+            break;
+        default:
+            body << "    report(\"SYNTAX ERROR\");" << endl;
+            return;
+        }
+        body << "    if (" << lhs << " " << cmp << " " << rhs << ")" << endl;
+        if (ctrl->getTarget() != NULL)
+            body << "        goto " << label(ctrl->getTarget()) << ";" << endl;
+        else
+            body << "        report(\"LINE NUMBER ERROR\");" << endl;
+        break;
+    }
+    }
+}
+
+/*
+ * Implementation notes: emitExp
+ * -----------------------------
+ * Returns a C operand holding the value of exp: a literal, an element
+ * of v or a temporary.  slot is set to the variable the operand names,
+ * or -1.  As in the register machine, a variable used as a left
+ * operand is copied to a temporary if the right operand assigns it.
+ *
+ * flagKnown records whether the flag of Expression::eval is known to
+ * be 1 for the expression just emitted; otherwise the generated code
+ * keeps it in the variable flag.
+ */
+
+string CEmitter::emitExp(Expression *exp, int temp, int &slot)
+{
+    slot = -1;
+    ostringstream dst;
+    dst << "t" << temp;
+    switch (exp->getType())
+    {
+    case CONSTANT:
+    {
+        int value = ((ConstantExp *)exp)->getValue();
+        flagKnown = true;
+        ostringstream literal;
+        if (value < 0)
+            literal << "(" << value << ")";
+        else
+            literal << value;
+        return literal.str();
+    }
+    case IDENTIFIER:
+        slot = ((IdentifierExp *)exp)->getSlot();
+        flagKnown = ((IdentifierExp *)exp)->isProvenDefined();
+        if (!flagKnown)
+            body << "    flag = check(" << defined(slot) << ");" << endl;
+        return variable(slot);
+    default:
+        break;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+        {
+            body << "    report(\"SYNTAX ERROR\");" << endl
+                 << "    flag = 0;" << endl;
+            flagKnown = false;
+            return "0";
+        }
+        int rhsSlot;
+        string value = emitExp(cexp->getRHS(), temp, rhsSlot);
+        int target = ((IdentifierExp *)cexp->getLHS())->getSlot();
+        flagKnown = true;
+        if (target < reservedCount)
+        {
+            body << "    report(\"SYNTAX ERROR\");" << endl;
+            slot = rhsSlot;
+            return value;
+        }
+        body << "    " << variable(target) << " = " << value << ";" << endl
+             << "    " << defined(target) << " = 1;" << endl;
+        slot = target;
+        return variable(target);
+    }
+    if (temp + 1 > temporaryCount)
+        temporaryCount = temp + 1;
+    int lhsSlot;
+    string lhs = emitExp(cexp->getLHS(), temp, lhsSlot);
+    if (lhsSlot >= 0 && assignsTo(cexp->getRHS(), lhsSlot))
+    {
+        body << "    " << dst.str() << " = " << lhs << ";" << endl;
+        lhs = dst.str();
+    }
+    int rhsSlot;
+    string rhs = emitExp(cexp->getRHS(), temp + 1, rhsSlot);
+    switch (cexp->getOperator())
+    {
+    case ADD_OP:
+        body << "    " << dst.str() << " = " << lhs << " + " << rhs << ";" << endl;
+        break;
+    case SUB_OP:
+        body << "    " << dst.str() << " = " << lhs << " - " << rhs << ";" << endl;
+        break;
+    case MUL_OP:
+        body << "    " << dst.str() << " = " << lhs << " * " << rhs << ";" << endl;
+        break;
+    case DIV_OP:
+        if (cexp->isDivisorNonzero())
+        {
+            body << "    " << dst.str() << " = " << lhs << " / " << rhs << ";" << endl;
+            flagKnown = true;
+            break;
+        }
+        body << "    if (" << rhs << " == 0)" << endl
+             << "    {" << endl
+             << "        report(\"DIVIDE BY ZERO\");" << endl
+             << "        " << dst.str() << " = 0;" << endl
+             << "        flag = 0;" << endl
+             << "    }" << endl
+             << "    else" << endl
+             << "    {" << endl
+             << "        " << dst.str() << " = " << lhs << " / " << rhs << ";" << endl
+             << "        flag = 1;" << endl
+             << "    }" << endl;
+        flagKnown = false;
+        break;
+    default:
+        body << "    report(\"SYNTAX ERROR\");" << endl
+             << "    " << dst.str() << " = 0;" << endl
+             << "    flag = 0;" << endl;
+        flagKnown = false;
+    }
+    return dst.str();
+}
+
+string CEmitter::label(Statement *stmt)
+{
+    ostringstream name;
+    name << "line_" << stmt->getLineNumber();
+    return name.str();
+}
+
+string CEmitter::variable(int slot)
+{
+    ostringstream name;
+    name << "v[" << slot << "]";
+    return name.str();
+}
+
+string CEmitter::defined(int slot)
+{
+    ostringstream name;
+    name << "d[" << slot << "]";
+    return name.str();
+}
+
+/*
+ * Implementation notes: assignsTo
+ * -------------------------------
+ * Returns true if evaluating exp stores into the variable in slot.
+ */
+
+bool CEmitter::assignsTo(Expression *exp, int slot)
+{
+    if (exp->getType() != COMPOUND)
+        return false;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP && cexp->getLHS()->getType() == IDENTIFIER && ((IdentifierExp *)cexp->getLHS())->getSlot() == slot)
+        return true;
+    return assignsTo(cexp->getLHS(), slot) || assignsTo(cexp->getRHS(), slot);
+}
@@ -0,0 +1,68 @@
+/*
+ * File: cemit.h
+ * -------------
+ * This interface exports the CEmitter class, which translates a parsed
+ * BASIC program into a standalone C program.
+ */
+
+#ifndef _cemit_h
+#define _cemit_h
+
+#include "exp.h"
+#include "program.h"
+#include "statement.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+/*
+ * Class: CEmitter
+ * ---------------
+ * This class walks the linked statements of a Program and writes an
+ * equivalent C program: every line becomes a label, GOTO and IF become
+ * goto, and INPUT, PRINT and the diagnostics of the interpreter are
+ * small runtime functions emitted at the top of the file.  The
+ * translation prints exactly what RUN prints when the program is
+ * started from its first line with no variables defined.
+ */
+
+class CEmitter
+{
+
+public:
+  /*
+ * Constructor: CEmitter
+ * Usage: CEmitter emitter(out);
+ * -----------------------
+ * Creates an emitter that writes the C program to out.
+ */
+
+  CEmitter(ostream &out);
+
+  /*
+ * Method: emit
+ * Usage: emitter.emit(program);
+ * -----------------------
+ * Links the program if needed and writes its translation.
+ */
+
+  void emit(Program &program);
+
+private:
+  void emitStatement(Statement *stmt);
+  string emitExp(Expression *exp, int temp, int &slot);
+  bool assignsTo(Expression *exp, int slot);
+  string label(Statement *stmt);
+  string variable(int slot);
+  string defined(int slot);
+
+  ostream &out;
+  ostringstream body;
+  int variableCount;
+  int reservedCount;
+  int temporaryCount;
+  bool flagKnown;
+};
+
+#endif
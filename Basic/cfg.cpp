@@ -0,0 +1,286 @@
+/*
+ * File: cfg.cpp
+ * -------------
+ * This file implements the BasicBlock and ControlFlowGraph classes.
+ */
+
+#include "cfg.h"
+#include "closedform.h"
+#include "evalstate.h"
+#include "program.h"
+#include "statement.h"
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+BasicBlock::BasicBlock(int id)
+{
+    this->id = id;
+    closedForm = NULL;
+    branch = NULL;
+    fallthrough = NULL;
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * All statements but the last simply run.  The last one is stepped,
+ * and since every jump target starts a block, the statement it
+ * returns is either the first statement of the branch or that of the
+ * fallthrough.  Letting step decide keeps the LINE NUMBER ERROR of an
+ * unresolved jump in one place.  A preheader only fills its slots.
+ */
+
+BasicBlock *BasicBlock::execute(EvalState &state)
+{
+    if (statements.empty())
+    {
+        int flag;
+        if (closedForm != NULL)
+            closedForm->run(state);
+        for (int i = 0; i < hoisted.size(); i++)
+            state.setValue(hoisted[i]->getHoistedSlot(), hoisted[i]->compute(state, flag));
+        return fallthrough;
+    }
+    Statement **stmt = &statements[0];
+    Statement **last = stmt + statements.size() - 1;
+    for (; stmt != last; stmt++)
+        (*stmt)->execute(state);
+    Statement *next = (*last)->step(state);
+    if (next == NULL)
+        return NULL;
+    if (branch != NULL && next == branch->getFirst())
+        return branch;
+    return fallthrough;
+}
+
+int BasicBlock::getId()
+{
+    return id;
+}
+
+vector<Statement *> &BasicBlock::getStatements()
+{
+    return statements;
+}
+
+Statement *BasicBlock::getFirst()
+{
+    if (statements.empty())
+        return fallthrough->getFirst();
+    return statements.front();
+}
+
+Statement *BasicBlock::getLast()
+{
+    if (statements.empty())
+        return fallthrough->getFirst();
+    return statements.back();
+}
+
+BasicBlock *BasicBlock::getBranch()
+{
+    return branch;
+}
+
+BasicBlock *BasicBlock::getFallthrough()
+{
+    return fallthrough;
+}
+
+vector<BasicBlock *> &BasicBlock::getSuccessors()
+{
+    return successors;
+}
+
+vector<BasicBlock *> &BasicBlock::getPredecessors()
+{
+    return predecessors;
+}
+
+vector<CompoundExp *> &BasicBlock::getHoisted()
+{
+    return hoisted;
+}
+
+ClosedForm *BasicBlock::getClosedForm()
+{
+    return closedForm;
+}
+
+void BasicBlock::setClosedForm(ClosedForm *form)
+{
+    closedForm = form;
+}
+
+/*
+ * Implementation notes: the ControlFlowGraph class
+ * ------------------------------------------------
+ * The graph is built in two passes over the linked statements: the
+ * first marks the leaders, the second cuts the chain into blocks at
+ * the leaders and connects them.
+ */
+
+static Statement *getJumpTarget(Statement *stmt);
+static bool endsBlock(Statement *stmt);
+
+ControlFlowGraph::ControlFlowGraph(Program &program, Statement *entry)
+{
+    this->entry = NULL;
+    program.link();
+    Statement *first = program.getLinkedStatement(program.getFirstLineNumber());
+    if (first == NULL)
+        return;
+    if (entry == NULL)
+        entry = first;
+
+    set<Statement *> leaders;
+    leaders.insert(first);
+    leaders.insert(entry);
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        if (getJumpTarget(stmt) != NULL)
+            leaders.insert(getJumpTarget(stmt));
+        if (endsBlock(stmt) && stmt->getNext() != NULL)
+            leaders.insert(stmt->getNext());
+    }
+
+    BasicBlock *block = NULL;
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        if (leaders.count(stmt) != 0)
+        {
+            block = new BasicBlock(blocks.size());
+            blocks.push_back(block);
+        }
+        block->statements.push_back(stmt);
+        blockOf[stmt] = block;
+    }
+
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        BasicBlock *block = blocks[i];
+        Statement *last = block->getLast();
+        if (last->getType() != END && last->getNext() != NULL)
+            block->fallthrough = blockOf[last->getNext()];
+        if (getJumpTarget(last) != NULL)
+            block->branch = blockOf[getJumpTarget(last)];
+        if (last->getType() == GOTO && block->branch != NULL)
+            block->fallthrough = NULL;
+        addEdge(block, block->fallthrough);
+        addEdge(block, block->branch);
+    }
+    this->entry = blockOf[entry];
+}
+
+ControlFlowGraph::~ControlFlowGraph()
+{
+    for (int i = 0; i < blocks.size(); i++)
+        delete blocks[i];
+}
+
+BasicBlock *ControlFlowGraph::getEntry()
+{
+    return entry;
+}
+
+vector<BasicBlock *> &ControlFlowGraph::getBlocks()
+{
+    return blocks;
+}
+
+int ControlFlowGraph::getBlockCount()
+{
+    return blocks.size();
+}
+
+BasicBlock *ControlFlowGraph::getBlock(Statement *stmt)
+{
+    map<Statement *, BasicBlock *>::iterator it = blockOf.find(stmt);
+    if (it == blockOf.end())
+        return NULL;
+    return it->second;
+}
+
+string ControlFlowGraph::toString()
+{
+    ostringstream out;
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        BasicBlock *block = blocks[i];
+        out << "B" << block->getId() << " [" << block->getFirst()->getLineNumber()
+            << "-" << block->getLast()->getLineNumber() << "] ->";
+        for (int j = 0; j < block->successors.size(); j++)
+            out << " B" << block->successors[j]->getId();
+        out << endl;
+    }
+    return out.str();
+}
+
+BasicBlock *ControlFlowGraph::insertPreheader(BasicBlock *header, const set<BasicBlock *> &loop)
+{
+    BasicBlock *pre = new BasicBlock(blocks.size());
+    blocks.push_back(pre);
+    pre->fallthrough = header;
+    vector<BasicBlock *> preds = header->predecessors;
+    header->predecessors.clear();
+    for (int i = 0; i < preds.size(); i++)
+    {
+        BasicBlock *pred = preds[i];
+        if (loop.count(pred) != 0)
+        {
+            header->predecessors.push_back(pred);
+            continue;
+        }
+        if (pred->branch == header)
+            pred->branch = pre;
+        if (pred->fallthrough == header)
+            pred->fallthrough = pre;
+        for (int j = 0; j < pred->successors.size(); j++)
+        {
+            if (pred->successors[j] == header)
+                pred->successors[j] = pre;
+        }
+        pre->predecessors.push_back(pred);
+    }
+    addEdge(pre, header);
+    if (entry == header)
+        entry = pre;
+    return pre;
+}
+
+void ControlFlowGraph::addEdge(BasicBlock *from, BasicBlock *to)
+{
+    if (to == NULL)
+        return;
+    for (int i = 0; i < from->successors.size(); i++)
+    {
+        if (from->successors[i] == to)
+            return;
+    }
+    from->successors.push_back(to);
+    to->predecessors.push_back(from);
+}
+
+/*
+ * Function: getJumpTarget
+ * -----------------------
+ * Returns the statement a GOTO or IF jumps to, or NULL.
+ */
+
+static Statement *getJumpTarget(Statement *stmt)
+{
+    if (stmt->getType() == GOTO)
+        return ((ControlGOTO *)stmt)->getTarget();
+    if (stmt->getType() == IF)
+        return ((ControlIF *)stmt)->getTarget();
+    return NULL;
+}
+
+static bool endsBlock(Statement *stmt)
+{
+    return stmt->getType() == GOTO || stmt->getType() == IF || stmt->getType() == END;
+}
@@ -0,0 +1,215 @@
+/*
+ * File: cfg.h
+ * -----------
+ * This interface exports the control-flow graph of a BASIC program:
+ * the BasicBlock class and the ControlFlowGraph that splits a linked
+ * Program into blocks.
+ */
+
+#ifndef _cfg_h
+#define _cfg_h
+
+#include "evalstate.h"
+#include "program.h"
+#include "statement.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+class ClosedForm;
+
+/*
+ * Class: BasicBlock
+ * -----------------
+ * This class represents a maximal run of statements that is always
+ * entered at its first statement and left after its last one.  Only
+ * the last statement of a block can be a GOTO, an IF or an END.
+ *
+ * A block has at most two successors: the branch, which is the block
+ * a GOTO or IF jumps to, and the fallthrough, which starts with the
+ * statement that follows the last one.  A GOTO or IF whose target line
+ * does not exist has no branch; like the statement itself, the block
+ * then continues with the fallthrough.
+ *
+ * A preheader, which ControlFlowGraph::insertPreheader puts in front
+ * of a loop, has no statements.  It runs the closed form of the loop,
+ * if any, evaluates the expressions hoisted out of the loop and falls
+ * through to the loop header, and it counts as starting with the first
+ * statement of the header.
+ */
+
+class BasicBlock
+{
+
+public:
+  /*
+ * Constructor: BasicBlock
+ * Usage: BasicBlock *block = new BasicBlock(id);
+ * -----------------------
+ * Creates an empty block.  Blocks are built by ControlFlowGraph.
+ */
+
+  BasicBlock(int id);
+
+  /*
+ * Method: execute
+ * Usage: block = block->execute(state);
+ * -----------------------
+ * Executes every statement of the block with the tree walker and
+ * returns the block that runs next, or NULL if the program stops.
+ */
+
+  BasicBlock *execute(EvalState &state);
+
+  /*
+ * Methods: getId, getStatements, getFirst, getLast
+ * Usage: int id = block->getId();
+ *        vector<Statement *> &stmts = block->getStatements();
+ * -----------------------
+ * Return the number of the block in its graph, its statements in
+ * order, and the first and last of them.
+ */
+
+  int getId();
+  vector<Statement *> &getStatements();
+  Statement *getFirst();
+  Statement *getLast();
+
+  /*
+ * Methods: getBranch, getFallthrough, getSuccessors, getPredecessors
+ * Usage: BasicBlock *target = block->getBranch();
+ *        vector<BasicBlock *> &succs = block->getSuccessors();
+ * -----------------------
+ * Return the edges of the block.  getBranch and getFallthrough return
+ * NULL where there is no such edge; getSuccessors lists the distinct
+ * successors, fallthrough first.
+ */
+
+  BasicBlock *getBranch();
+  BasicBlock *getFallthrough();
+  vector<BasicBlock *> &getSuccessors();
+  vector<BasicBlock *> &getPredecessors();
+
+  /*
+ * Method: getHoisted
+ * Usage: vector<CompoundExp *> &hoisted = block->getHoisted();
+ * -----------------------
+ * Returns the expressions a preheader evaluates into their hoisted
+ * slots.  The list is empty for every other block.
+ */
+
+  vector<CompoundExp *> &getHoisted();
+
+  /*
+ * Methods: getClosedForm, setClosedForm
+ * Usage: ClosedForm *form = block->getClosedForm();
+ *        block->setClosedForm(form);
+ * -----------------------
+ * Reads or changes the closed form a preheader runs, which is NULL
+ * for every other block.
+ */
+
+  ClosedForm *getClosedForm();
+  void setClosedForm(ClosedForm *form);
+
+private:
+  int id;
+  vector<Statement *> statements;
+  vector<CompoundExp *> hoisted;
+  ClosedForm *closedForm;
+  BasicBlock *branch;
+  BasicBlock *fallthrough;
+  vector<BasicBlock *> successors;
+  vector<BasicBlock *> predecessors;
+
+  friend class ControlFlowGraph;
+};
+
+/*
+ * Class: ControlFlowGraph
+ * -----------------------
+ * This class splits the linked statements of a program into basic
+ * blocks.  A block starts at the first statement, at the target of
+ * every GOTO and IF, after every GOTO, IF and END, and at the entry
+ * statement, so that RUN can start at any line.  Blocks are numbered
+ * in line order, followed by any preheaders inserted later.
+ */
+
+class ControlFlowGraph
+{
+
+public:
+  /*
+ * Constructor: ControlFlowGraph
+ * Usage: ControlFlowGraph cfg(program, entry);
+ * -----------------------
+ * Links the program if needed and builds its graph.  entry is the
+ * statement execution starts at, or NULL for the first line.
+ */
+
+  ControlFlowGraph(Program &program, Statement *entry = NULL);
+
+  /*
+ * Destructor: ~ControlFlowGraph
+ * Usage: usually implicit
+ * -----------------------
+ * Frees the blocks.  The statements belong to the program.
+ */
+
+  ~ControlFlowGraph();
+
+  /*
+ * Methods: getEntry, getBlocks, getBlockCount
+ * Usage: BasicBlock *block = cfg.getEntry();
+ *        vector<BasicBlock *> &blocks = cfg.getBlocks();
+ * -----------------------
+ * Return the block execution starts at (NULL for an empty program),
+ * all blocks in line order, and their number.
+ */
+
+  BasicBlock *getEntry();
+  vector<BasicBlock *> &getBlocks();
+  int getBlockCount();
+
+  /*
+ * Method: getBlock
+ * Usage: BasicBlock *block = cfg.getBlock(stmt);
+ * -----------------------
+ * Returns the block that contains stmt, or NULL if it has none.
+ */
+
+  BasicBlock *getBlock(Statement *stmt);
+
+  /*
+ * Method: toString
+ * Usage: cout << cfg.toString();
+ * -----------------------
+ * Returns one line per block giving its id, its first and last line
+ * and its successors, for debugging.
+ */
+
+  string toString();
+
+  /*
+ * Method: insertPreheader
+ * Usage: BasicBlock *pre = cfg.insertPreheader(header, loop);
+ * -----------------------
+ * Adds an empty block that falls through to header and moves every
+ * edge into header from a block outside loop onto it, so the new
+ * block runs each time the loop is entered but not on its back edges.
+ * If execution starts at header, it now starts at the preheader.
+ */
+
+  BasicBlock *insertPreheader(BasicBlock *header, const set<BasicBlock *> &loop);
+
+private:
+  void addEdge(BasicBlock *from, BasicBlock *to);
+
+  vector<BasicBlock *> blocks;
+  map<Statement *, BasicBlock *> blockOf;
+  BasicBlock *entry;
+};
+
+#endif
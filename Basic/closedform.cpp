@@ -0,0 +1,382 @@
+/*
+ * File: closedform.cpp
+ * --------------------
+ * This file implements the ClosedForm class.
+ */
+
+#include "closedform.h"
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+#include <climits>
+#include <set>
+#include <vector>
+using namespace std;
+
+static vector<vector<unsigned> > multiply(vector<vector<unsigned> > &a, vector<vector<unsigned> > &b);
+static vector<unsigned> multiply(vector<vector<unsigned> > &a, vector<unsigned> &x);
+
+ClosedForm::ClosedForm()
+{
+    recognized = false;
+}
+
+/*
+ * Implementation notes: recognize
+ * -------------------------------
+ * The statements are followed from the header along their links until
+ * the one that closes the loop.  The loop must consist of exactly the
+ * statements passed, so nothing else in the loop can jump into the
+ * middle of the sequence, and the test must not carry an idiom.
+ */
+
+bool ClosedForm::recognize(Statement *header, const set<Statement *> &statements, int reservedCount)
+{
+    recognized = false;
+    slots.clear();
+    updates.clear();
+    ControlIF *test = NULL;
+    int length = 0;
+    for (Statement *stmt = header; true; stmt = stmt->getNext())
+    {
+        if (stmt == NULL || statements.count(stmt) == 0)
+            return false;
+        length++;
+        if (stmt->getType() == LET)
+        {
+            Expression *exp = ((SeqLET *)stmt)->getExp();
+            if (exp->getType() != COMPOUND || ((CompoundExp *)exp)->getOperator() != ASSIGN_OP)
+                return false;
+            CompoundExp *assign = (CompoundExp *)exp;
+            if (assign->getLHS()->getType() != IDENTIFIER)
+                return false;
+            int slot = ((IdentifierExp *)assign->getLHS())->getSlot();
+            if (indexOf(slot) < 0)
+                slots.push_back(slot);
+            Update update = {indexOf(slot), assign->getRHS()};
+            updates.push_back(update);
+        }
+        else if (stmt->getType() == IF)
+        {
+            ControlIF *ctrl = (ControlIF *)stmt;
+            if (test != NULL || ctrl->getTarget() == NULL || ctrl->getIdiom().type != NO_IDIOM)
+                return false;
+            test = ctrl;
+            testPosition = updates.size();
+            exitWhen = ctrl->getTarget() != header;
+            if (!exitWhen)
+                break;
+            if (statements.count(ctrl->getTarget()) != 0)
+                return false;
+        }
+        else if (stmt->getType() == GOTO)
+        {
+            if (test == NULL || ((ControlGOTO *)stmt)->getTarget() != header)
+                return false;
+            break;
+        }
+        else if (stmt->getType() != REM)
+            return false;
+    }
+    if (length != statements.size())
+        return false;
+    assignedCount = slots.size();
+
+    Expression *lhs = test->getLHS();
+    Expression *rhs = test->getRHS();
+    cmp = test->getCmp();
+    if (lhs->getType() != IDENTIFIER || indexOf(((IdentifierExp *)lhs)->getSlot()) < 0)
+    {
+        swap(lhs, rhs);
+        cmp = cmp == '<' ? '>' : cmp == '>' ? '<' : cmp;
+    }
+    if (lhs->getType() != IDENTIFIER || (cmp != '<' && cmp != '>' && cmp != '='))
+        return false;
+    induction = indexOf(((IdentifierExp *)lhs)->getSlot());
+    bound = rhs;
+    if (induction < 0 || !isAffine(bound) || !isInvariant(bound))
+        return false;
+
+    incrementPosition = -1;
+    for (int i = 0; i < updates.size(); i++)
+    {
+        if (!isAffine(updates[i].exp))
+            return false;
+        if (updates[i].index != induction)
+            continue;
+        if (incrementPosition >= 0 || updates[i].exp->getType() != COMPOUND)
+            return false;
+        CompoundExp *cexp = (CompoundExp *)updates[i].exp;
+        Expression *var = cexp->getLHS();
+        Expression *amount = cexp->getRHS();
+        if (cexp->getOperator() == ADD_OP && var->getType() == CONSTANT)
+            swap(var, amount);
+        if (var->getType() != IDENTIFIER || ((IdentifierExp *)var)->getSlot() != slots[induction])
+            return false;
+        if (amount->getType() != CONSTANT || ((ConstantExp *)amount)->getValue() == 0)
+            return false;
+        step = ((ConstantExp *)amount)->getValue();
+        if (cexp->getOperator() == SUB_OP)
+            step = (int)(0u - (unsigned)step);
+        else if (cexp->getOperator() != ADD_OP)
+            return false;
+        incrementPosition = i;
+    }
+    if (incrementPosition < 0)
+        return false;
+
+    for (int i = 0; i < updates.size(); i++)
+        addSlots(updates[i].exp);
+    addSlots(bound);
+    for (int i = 0; i < slots.size(); i++)
+    {
+        if (slots[i] < reservedCount)
+            return false;
+    }
+    recognized = true;
+    return true;
+}
+
+bool ClosedForm::isRecognized()
+{
+    return recognized;
+}
+
+vector<int> &ClosedForm::getSlots()
+{
+    return slots;
+}
+
+/*
+ * Implementation notes: advance
+ * -----------------------------
+ * The affine map of one iteration is a matrix over the assigned
+ * variables plus a constant 1, built by evaluating the assignments
+ * symbolically in the order they run.  Its power is applied to the
+ * current values by repeated squaring.
+ */
+
+bool ClosedForm::advance(vector<int> &values)
+{
+    long long count;
+    if (!recognized || !getTripCount(values, count))
+        return false;
+    int size = assignedCount + 1;
+    vector<vector<unsigned> > power(assignedCount, vector<unsigned>(size, 0));
+    for (int i = 0; i < assignedCount; i++)
+        power[i][i] = 1;
+    for (int i = 0; i < updates.size(); i++)
+        power[updates[i].index] = evalAffine(updates[i].exp, power, values);
+    power.push_back(vector<unsigned>(size, 0));
+    power[assignedCount][assignedCount] = 1;
+
+    vector<unsigned> x(size);
+    for (int i = 0; i < assignedCount; i++)
+        x[i] = values[i];
+    x[assignedCount] = 1;
+    while (count > 0)
+    {
+        if (count & 1)
+            x = multiply(power, x);
+        count >>= 1;
+        if (count > 0)
+            power = multiply(power, power);
+    }
+    for (int i = 0; i < assignedCount; i++)
+        values[i] = (int)x[i];
+    return true;
+}
+
+void ClosedForm::run(EvalState &state)
+{
+    vector<int> values(slots.size());
+    for (int i = 0; i < slots.size(); i++)
+    {
+        if (!state.isDefined(slots[i]))
+            return;
+        values[i] = state.getValue(slots[i]);
+    }
+    if (!advance(values))
+        return;
+    for (int i = 0; i < assignedCount; i++)
+        state.setValue(slots[i], values[i]);
+}
+
+/*
+ * Method: isAffine
+ * ----------------
+ * Returns true if exp is built from constants and variables with +, -
+ * and products that have a factor which does not change in the loop.
+ */
+
+bool ClosedForm::isAffine(Expression *exp)
+{
+    if (exp->getType() != COMPOUND)
+        return true;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    int op = cexp->getOperator();
+    if (op != ADD_OP && op != SUB_OP && op != MUL_OP)
+        return false;
+    if (!isAffine(cexp->getLHS()) || !isAffine(cexp->getRHS()))
+        return false;
+    return op != MUL_OP || isInvariant(cexp->getLHS()) || isInvariant(cexp->getRHS());
+}
+
+bool ClosedForm::isInvariant(Expression *exp)
+{
+    if (exp->getType() == IDENTIFIER)
+    {
+        int index = indexOf(((IdentifierExp *)exp)->getSlot());
+        return index < 0 || index >= assignedCount;
+    }
+    if (exp->getType() == COMPOUND)
+        return isInvariant(((CompoundExp *)exp)->getLHS()) && isInvariant(((CompoundExp *)exp)->getRHS());
+    return true;
+}
+
+int ClosedForm::indexOf(int slot)
+{
+    for (int i = 0; i < slots.size(); i++)
+    {
+        if (slots[i] == slot)
+            return i;
+    }
+    return -1;
+}
+
+void ClosedForm::addSlots(Expression *exp)
+{
+    if (exp->getType() == IDENTIFIER)
+    {
+        int slot = ((IdentifierExp *)exp)->getSlot();
+        if (indexOf(slot) < 0)
+            slots.push_back(slot);
+    }
+    else if (exp->getType() == COMPOUND)
+    {
+        addSlots(((CompoundExp *)exp)->getLHS());
+        addSlots(((CompoundExp *)exp)->getRHS());
+    }
+}
+
+/*
+ * Method: getTripCount
+ * --------------------
+ * Sets count to the number of iterations that complete before the test
+ * leaves the loop, and returns true if there are any and the loop
+ * variable stays within range until the test.  The value the test
+ * sees goes up by step on every iteration; the loop is left as soon as
+ * it is below or above some limit, or equal or unequal to n.
+ */
+
+bool ClosedForm::getTripCount(vector<int> &values, long long &count)
+{
+    vector<vector<unsigned> > none;
+    long long n = (int)evalAffine(bound, none, values)[assignedCount];
+    long long first = values[induction];
+    if (incrementPosition < testPosition)
+        first += step;
+    if (first < INT_MIN || first > INT_MAX)
+        return false;
+    if (cmp == '=' && exitWhen)
+    {
+        long long distance = n - first;
+        if (distance % step != 0 || distance / step < 0)
+            return false;
+        count = distance / step;
+    }
+    else if (cmp == '=')
+        count = first == n ? 1 : 0;
+    else if ((cmp == '<') == exitWhen)
+    {
+        long long limit = exitWhen ? n : n + 1;
+        if (first < limit)
+            count = 0;
+        else if (step > 0)
+            return false;
+        else
+            count = (first - limit) / -(long long)step + 1;
+    }
+    else
+    {
+        long long limit = exitWhen ? n : n - 1;
+        if (first > limit)
+            count = 0;
+        else if (step < 0)
+            return false;
+        else
+            count = (limit - first) / step + 1;
+    }
+    long long last = first + count * step;
+    return count > 0 && last >= INT_MIN && last <= INT_MAX;
+}
+
+/*
+ * Method: evalAffine
+ * ------------------
+ * Returns exp as the coefficients of the assigned variables at the
+ * start of an iteration followed by a constant term, given forms, the
+ * same for the current value of every assigned variable.
+ */
+
+vector<unsigned> ClosedForm::evalAffine(Expression *exp, vector<vector<unsigned> > &forms, vector<int> &values)
+{
+    vector<unsigned> result(assignedCount + 1, 0);
+    if (exp->getType() == CONSTANT)
+    {
+        result[assignedCount] = ((ConstantExp *)exp)->getValue();
+        return result;
+    }
+    if (exp->getType() == IDENTIFIER)
+    {
+        int index = indexOf(((IdentifierExp *)exp)->getSlot());
+        if (index < assignedCount)
+            return forms[index];
+        result[assignedCount] = values[index];
+        return result;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    vector<unsigned> lhs = evalAffine(cexp->getLHS(), forms, values);
+    vector<unsigned> rhs = evalAffine(cexp->getRHS(), forms, values);
+    if (cexp->getOperator() == MUL_OP && isInvariant(cexp->getLHS()))
+        swap(lhs, rhs);
+    for (int i = 0; i <= assignedCount; i++)
+    {
+        if (cexp->getOperator() == ADD_OP)
+            result[i] = lhs[i] + rhs[i];
+        else if (cexp->getOperator() == SUB_OP)
+            result[i] = lhs[i] - rhs[i];
+        else
+            result[i] = lhs[i] * rhs[assignedCount];
+    }
+    return result;
+}
+
+static vector<vector<unsigned> > multiply(vector<vector<unsigned> > &a, vector<vector<unsigned> > &b)
+{
+    int size = a.size();
+    vector<vector<unsigned> > product(size, vector<unsigned>(size, 0));
+    for (int i = 0; i < size; i++)
+    {
+        for (int k = 0; k < size; k++)
+        {
+            if (a[i][k] == 0)
+                continue;
+            for (int j = 0; j < size; j++)
+                product[i][j] += a[i][k] * b[k][j];
+        }
+    }
+    return product;
+}
+
+static vector<unsigned> multiply(vector<vector<unsigned> > &a, vector<unsigned> &x)
+{
+    int size = a.size();
+    vector<unsigned> product(size, 0);
+    for (int i = 0; i < size; i++)
+    {
+        for (int k = 0; k < size; k++)
+            product[i] += a[i][k] * x[k];
+    }
+    return product;
+}
@@ -0,0 +1,140 @@
+/*
+ * File: closedform.h
+ * ------------------
+ * This interface exports the ClosedForm class, which computes what a
+ * simple accumulation loop leaves behind without running its
+ * iterations one by one.
+ */
+
+#ifndef _closedform_h
+#define _closedform_h
+
+#include "evalstate.h"
+#include "exp.h"
+#include "statement.h"
+#include <set>
+#include <vector>
+using namespace std;
+
+/*
+ * Class: ClosedForm
+ * -----------------
+ * This class recognizes a loop whose statements, in the order of their
+ * links starting at the header, are
+ *
+ *  LET and REM statements, then IF i < n THEN header
+ *
+ * or the same with a test IF i < n THEN exit anywhere among them and a
+ * closing GOTO header, where < may also be > or =.  The loop variable
+ * i is assigned once, by LET i = i + c for a constant c, and n does not
+ * change in the loop.  Every other assignment must be affine: sums,
+ * differences and constants, and products with at least one factor
+ * that does not change in the loop.  No division is allowed.
+ *
+ * One iteration then maps the assigned variables through an affine
+ * transformation, and k iterations through its k-th power, which takes
+ * a logarithmic number of steps.  All arithmetic is modulo 2^32, like
+ * the wrapping arithmetic of the interpreter, so a sum that overflows
+ * comes out exactly as the loop would compute it.  The number of
+ * iterations is worked out from i, c and n before anything changes;
+ * the loop runs normally when i would overflow before the test stops
+ * it, or when a variable it reads is not defined.
+ *
+ * The form skips the iterations that complete before the test leaves
+ * the loop, and the loop then runs its last, partial iteration and
+ * the test as written.
+ */
+
+class ClosedForm
+{
+
+public:
+  /*
+ * Constructor: ClosedForm
+ * Usage: ClosedForm form;
+ * -----------------------
+ * Creates a form that has not recognized any loop.
+ */
+
+  ClosedForm();
+
+  /*
+ * Method: recognize
+ * Usage: if (form.recognize(header, statements, reservedCount)) . . .
+ * -----------------------
+ * Returns true if the loop made of statements and headed by header has
+ * the shape described above.  reservedCount is the number of keyword
+ * slots, which the loop must not use.  The idioms of the program must
+ * already be marked.
+ */
+
+  bool recognize(Statement *header, const set<Statement *> &statements, int reservedCount);
+
+  /*
+ * Method: isRecognized
+ * Usage: if (form.isRecognized()) . . .
+ * -----------------------
+ * Returns true if the last call to recognize succeeded.
+ */
+
+  bool isRecognized();
+
+  /*
+ * Method: getSlots
+ * Usage: vector<int> &slots = form.getSlots();
+ * -----------------------
+ * Returns the variables the loop reads or assigns, the assigned ones
+ * first.  The form applies only if all of them are defined.
+ */
+
+  vector<int> &getSlots();
+
+  /*
+ * Method: advance
+ * Usage: if (form.advance(values)) . . .
+ * -----------------------
+ * Skips the complete iterations of the loop, given the values of the
+ * variables in the order of getSlots.  Returns true if it did, with
+ * the assigned variables updated in values, and false if the loop has
+ * to run as written.
+ */
+
+  bool advance(vector<int> &values);
+
+  /*
+ * Method: run
+ * Usage: form.run(state);
+ * -----------------------
+ * Calls advance on the variables of state and stores the result.
+ */
+
+  void run(EvalState &state);
+
+private:
+  struct Update
+  {
+    int index;
+    Expression *exp;
+  };
+
+  bool isAffine(Expression *exp);
+  bool isInvariant(Expression *exp);
+  int indexOf(int slot);
+  void addSlots(Expression *exp);
+  bool getTripCount(vector<int> &values, long long &count);
+  vector<unsigned> evalAffine(Expression *exp, vector<vector<unsigned> > &forms, vector<int> &values);
+
+  vector<int> slots;
+  vector<Update> updates;
+  int assignedCount;
+  int testPosition;
+  int induction;
+  int incrementPosition;
+  int step;
+  Expression *bound;
+  char cmp;
+  bool exitWhen;
+  bool recognized;
+};
+
+#endif
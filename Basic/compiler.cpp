@@ -0,0 +1,266 @@
+/*
+ * File: compiler.cpp
+ * ------------------
+ * This file implements the Compiler class.
+ */
+
+#include "compiler.h"
+#include "bytecode.h"
+#include "exp.h"
+#include "loops.h"
+#include "program.h"
+#include "statement.h"
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Implementation notes: the Compiler class
+ * ----------------------------------------------
+ * Expressions are emitted in postfix order, so the left operand is
+ * always evaluated before the right one, exactly as CompoundExp::eval
+ * does.  Statements are emitted in the order of the links set up by
+ * Program::link, and jumps are patched once the address of every
+ * linked target is known.
+ *
+ * The preheader of a loop is emitted in front of its header line, so
+ * falling into the loop or jumping to the line runs it; back edges
+ * jump past it.  It starts with the closed form of the loop, if any.
+ * A hoisted expression is a load of its hidden slot.  The finished
+ * code is handed to Bytecode::fuse for its superinstructions.
+ */
+
+Compiler::Compiler(Bytecode &code) : code(code)
+{
+    current = NULL;
+}
+
+void Compiler::compile(Program &program, LoopInvariants *loops)
+{
+    program.link();
+    map<Statement *, int> loopAddresses;
+    Statement *stmt = program.getLinkedStatement(program.getFirstLineNumber());
+    for (; stmt != NULL; stmt = stmt->getNext())
+    {
+        code.setLineAddress(stmt->getLineNumber(), code.size());
+        if (loops != NULL && (!loops->getPreheader(stmt).empty() || loops->getClosedForm(stmt) != NULL))
+        {
+            if (loops->getClosedForm(stmt) != NULL)
+                code.emit(OP_CLOSED_FORM, code.addClosedForm(loops->getClosedForm(stmt)));
+            vector<CompoundExp *> &hoisted = loops->getPreheader(stmt);
+            for (int i = 0; i < hoisted.size(); i++)
+            {
+                compileCompound(hoisted[i], 0);
+                code.emit(OP_STORE, hoisted[i]->getHoistedSlot());
+                code.emit(OP_POP);
+            }
+            loopAddresses[stmt] = code.size();
+        }
+        current = stmt;
+        compileStatement(stmt);
+    }
+    code.emit(OP_HALT);
+
+    /*
+     * A jump to a missing line reports LINE NUMBER ERROR and falls
+     * through to the next instruction, so it is routed to a small
+     * stub placed after the program.
+     */
+    for (int i = 0; i < jumps.size(); i++)
+    {
+        int target;
+        if (loopAddresses.count(jumps[i].target) != 0 && loops->isBackEdge(jumps[i].from, jumps[i].target))
+            target = loopAddresses[jumps[i].target];
+        else if (jumps[i].target != NULL)
+            target = code.getLineAddress(jumps[i].target->getLineNumber());
+        else
+        {
+            target = code.emit(OP_LINE_ERROR);
+            code.emit(OP_JUMP, jumps[i].pc + 1);
+        }
+        code.patch(jumps[i].pc, target);
+    }
+    jumps.clear();
+    code.fuse();
+}
+
+void Compiler::compileStatement(Statement *stmt)
+{
+    if (stmt == NULL)
+        return;
+    switch (stmt->getType())
+    {
+    case REM:
+        break;
+    case LET:
+    {
+        if (((SeqLET *)stmt)->isDead())
+            break;
+        Expression *exp = ((SeqLET *)stmt)->getExp();
+        if (exp->getType() != COMPOUND)
+            code.emit(OP_NOT_COMPOUND);
+        compileExp(exp, 0);
+        code.emit(OP_POP);
+        break;
+    }
+    case PRINT:
+        compileExp(((SeqPRINT *)stmt)->getExp(), 0);
+        code.emit(OP_PRINT);
+        break;
+    case INPUT:
+        code.emit(OP_INPUT, ((SeqINPUT *)stmt)->getSlot());
+        break;
+    case END:
+        code.emit(OP_HALT);
+        break;
+    case GOTO:
+        emitJump(OP_JUMP, ((ControlGOTO *)stmt)->getTarget());
+        break;
+    case IF:
+    {
+        ControlIF *ctrl = (ControlIF *)stmt;
+        if (ctrl->getIdiom().type != NO_IDIOM)
+        {
+            compileIdiom(ctrl);
+            break;
+        }
+        compileExp(ctrl->getLHS(), 0);
+        compileExp(ctrl->getRHS(), 1);
+        switch (ctrl->getCmp())
+        {
+        case '>':
+            emitJump(OP_JUMP_GT, ctrl->getTarget());
+            break;
+        case '<':
+            emitJump(OP_JUMP_LT, ctrl->getTarget());
+            break;
+        case '=':
+            emitJump(OP_JUMP_EQ, ctrl->getTarget());
+            break;
+        default:
+            code.emit(OP_BAD_CMP);
+        }
+        break;
+    }
+    }
+}
+
+/*
+ * Implementation notes: compileIdiom
+ * ----------------------------------
+ * An idiom found by the IdiomRecognizer works on its variables in
+ * place and always continues at the target of its IF.
+ */
+
+void Compiler::compileIdiom(ControlIF *ctrl)
+{
+    Idiom &idiom = ctrl->getIdiom();
+    switch (idiom.type)
+    {
+    case ABS_IDIOM:
+        code.emit(OP_ABS, idiom.a);
+        break;
+    case MAX_IDIOM:
+    case MIN_IDIOM:
+        compileExp(idiom.operand, 0);
+        code.emit(idiom.type == MAX_IDIOM ? OP_MAX : OP_MIN, idiom.a);
+        break;
+    case GCD_IDIOM:
+        code.noteStackDepth(2);
+        code.emit(OP_LOAD_DEFINED, idiom.a);
+        code.emit(OP_LOAD_DEFINED, idiom.b);
+        code.emit(OP_GCD, idiom.t);
+        code.emit(OP_STORE, idiom.b);
+        code.emit(OP_POP);
+        code.emit(OP_STORE, idiom.a);
+        code.emit(OP_POP);
+        break;
+    default:
+        break;
+    }
+    emitJump(OP_JUMP, ctrl->getTarget());
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * The depth argument is the number of values already on the stack,
+ * which lets the compiler size the operand stack of the VM.
+ */
+
+void Compiler::compileExp(Expression *exp, int depth)
+{
+    code.noteStackDepth(depth + 1);
+    switch (exp->getType())
+    {
+    case CONSTANT:
+        code.emit(OP_CONST, ((ConstantExp *)exp)->getValue());
+        break;
+    case IDENTIFIER:
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        code.emit(id->isProvenDefined() ? OP_LOAD_DEFINED : OP_LOAD, id->getSlot());
+        break;
+    }
+    case COMPOUND:
+    {
+        CompoundExp *cexp = (CompoundExp *)exp;
+        if (cexp->getHoistedSlot() >= 0)
+            code.emit(OP_LOAD_DEFINED, cexp->getHoistedSlot());
+        else
+            compileCompound(cexp, depth);
+        break;
+    }
+    }
+}
+
+void Compiler::compileCompound(CompoundExp *cexp, int depth)
+{
+    if (cexp->isRemainder())
+    {
+        compileExp(cexp->getLHS(), depth);
+        compileExp(cexp->getRemainderDivisor(), depth + 1);
+        code.emit(OP_REM);
+        return;
+    }
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+        {
+            code.emit(OP_BAD_ASSIGN);
+            return;
+        }
+        compileExp(cexp->getRHS(), depth);
+        code.emit(OP_STORE, ((IdentifierExp *)cexp->getLHS())->getSlot());
+        return;
+    }
+    compileExp(cexp->getLHS(), depth);
+    compileExp(cexp->getRHS(), depth + 1);
+    switch (cexp->getOperator())
+    {
+    case ADD_OP:
+        code.emit(OP_ADD);
+        break;
+    case SUB_OP:
+        code.emit(OP_SUB);
+        break;
+    case MUL_OP:
+        code.emit(OP_MUL);
+        break;
+    case DIV_OP:
+        code.emit(cexp->isDivisorNonzero() ? OP_DIV_NONZERO : OP_DIV);
+        break;
+    default:
+        code.emit(OP_BAD_OP);
+    }
+}
+
+void Compiler::emitJump(int op, Statement *target)
+{
+    PendingJump jump;
+    jump.pc = code.emit(op, -1);
+    jump.from = current;
+    jump.target = target;
+    jumps.push_back(jump);
+}
@@ -0,0 +1,70 @@
+/*
+ * File: compiler.h
+ * ----------------
+ * This interface exports the Compiler class, which lowers the parsed
+ * statements of a Program into Bytecode for the stack VM.
+ */
+
+#ifndef _compiler_h
+#define _compiler_h
+
+#include "bytecode.h"
+#include "exp.h"
+#include "loops.h"
+#include "program.h"
+#include "statement.h"
+#include <vector>
+using namespace std;
+
+/*
+ * Class: Compiler
+ * ---------------
+ * This class walks every line of a program once and emits the
+ * equivalent instructions.  The generated code reproduces the tree
+ * walker exactly, including the order and text of every diagnostic.
+ */
+
+class Compiler
+{
+
+public:
+  /*
+ * Constructor: Compiler
+ * Usage: Compiler compiler(code);
+ * -----------------------
+ * Creates a compiler that appends its output to code.
+ */
+
+  Compiler(Bytecode &code);
+
+  /*
+ * Method: compile
+ * Usage: compiler.compile(program, loops);
+ * -----------------------
+ * Links the program if needed and compiles all of its lines.  If
+ * loops is not NULL, the expressions it hoisted are computed in the
+ * preheaders of their loops.
+ */
+
+  void compile(Program &program, LoopInvariants *loops = NULL);
+
+private:
+  void compileStatement(Statement *stmt);
+  void compileIdiom(ControlIF *ctrl);
+  void compileExp(Expression *exp, int depth);
+  void compileCompound(CompoundExp *cexp, int depth);
+  void emitJump(int op, Statement *target);
+
+  struct PendingJump
+  {
+    int pc;
+    Statement *from;
+    Statement *target;
+  };
+
+  Bytecode &code;
+  vector<PendingJump> jumps;
+  Statement *current;
+};
+
+#endif
@@ -0,0 +1,500 @@
+/*
+ * File: copies.cpp
+ * ----------------
+ * This file implements copy propagation and dead-store elimination.
+ */
+
+#include "copies.h"
+#include "cfg.h"
+#include "exp.h"
+#include "statement.h"
+#include <vector>
+using namespace std;
+
+/*
+ * Type: Copies
+ * ------------
+ * The state of the copy propagation at one point: source[p] is the
+ * variable that p is a copy of, or -1.
+ */
+
+struct Copies
+{
+    vector<int> source;
+    int reservedCount;
+    bool mark;
+};
+
+/*
+ * Type: Event
+ * -----------
+ * A read (write == false) or an assignment of the variable slot, as
+ * the liveness analysis replays them.
+ */
+
+struct Event
+{
+    bool write;
+    int slot;
+};
+
+static vector<Expression *> getExpressions(Statement *stmt);
+static void clearExp(Expression *exp);
+static bool meetCopies(ControlFlowGraph &cfg, BasicBlock *block, vector<vector<int> > &out, vector<bool> &visited, Copies &c);
+static void transferExp(Expression *exp, Copies &c);
+static void transferStatement(Statement *stmt, Copies &c);
+static void kill(int slot, Copies &c);
+static bool isExit(BasicBlock *block);
+static bool isStore(Statement *stmt, int reservedCount);
+static bool isPure(Expression *exp);
+static void collectEvents(Expression *exp, int reservedCount, vector<Event> &events);
+static void collectEvents(Statement *stmt, int reservedCount, vector<Event> &events);
+static bool transferLiveness(BasicBlock *block, vector<bool> &live, int reservedCount, bool mark);
+
+void clearCopies(ControlFlowGraph &cfg)
+{
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+        {
+            vector<Expression *> exps = getExpressions(stmts[j]);
+            for (int k = 0; k < exps.size(); k++)
+                clearExp(exps[k]);
+        }
+    }
+}
+
+/*
+ * Implementation notes: propagateCopies
+ * -------------------------------------
+ * Available copies are a forward "must" problem like definedness.  A
+ * block whose predecessors have not been visited yet is skipped, and
+ * the meet only looks at the visited ones; the copies can only shrink
+ * as more predecessors are taken into account, so the iteration still
+ * reaches the largest fixpoint.  The entry block starts without any
+ * copies, and so does a block never reached.
+ */
+
+void propagateCopies(ControlFlowGraph &cfg, int slotCount, int reservedCount)
+{
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    int n = blocks.size();
+    vector<vector<int> > out(n);
+    vector<bool> visited(n, false);
+
+    Copies c;
+    c.source.assign(slotCount, -1);
+    c.reservedCount = reservedCount;
+    c.mark = false;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < n; i++)
+        {
+            if (!meetCopies(cfg, blocks[i], out, visited, c))
+                continue;
+            vector<Statement *> &stmts = blocks[i]->getStatements();
+            for (int j = 0; j < stmts.size(); j++)
+                transferStatement(stmts[j], c);
+            if (!visited[i] || c.source != out[i])
+            {
+                out[i] = c.source;
+                visited[i] = true;
+                changed = true;
+            }
+        }
+    }
+
+    c.mark = true;
+    for (int i = 0; i < n; i++)
+    {
+        meetCopies(cfg, blocks[i], out, visited, c);
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+            transferStatement(stmts[j], c);
+    }
+}
+
+/*
+ * Implementation notes: eliminateDeadStores
+ * -----------------------------------------
+ * Liveness is a backward "may" problem; a block that can stop the
+ * program has every variable live at its end.  A store
+ * found dead no longer reads anything, which can make the stores of
+ * the variables it read dead in turn, so the analysis is repeated
+ * until no new store is found.
+ */
+
+void eliminateDeadStores(ControlFlowGraph &cfg, int slotCount, int reservedCount)
+{
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    int n = blocks.size();
+    for (int i = 0; i < n; i++)
+    {
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+        {
+            if (stmts[j]->getType() == LET)
+                ((SeqLET *)stmts[j])->setDead(false);
+        }
+    }
+
+    vector<vector<bool> > in(n, vector<bool>(slotCount, false));
+    vector<bool> live;
+    bool found = true;
+    while (found)
+    {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (int i = n - 1; i >= 0; i--)
+            {
+                vector<BasicBlock *> &succs = blocks[i]->getSuccessors();
+                live.assign(slotCount, isExit(blocks[i]));
+                for (int j = 0; j < succs.size(); j++)
+                {
+                    vector<bool> &succIn = in[succs[j]->getId()];
+                    for (int k = 0; k < slotCount; k++)
+                    {
+                        if (succIn[k])
+                            live[k] = true;
+                    }
+                }
+                transferLiveness(blocks[i], live, reservedCount, false);
+                if (live != in[i])
+                {
+                    in[i] = live;
+                    changed = true;
+                }
+            }
+        }
+        found = false;
+        for (int i = 0; i < n; i++)
+        {
+            vector<BasicBlock *> &succs = blocks[i]->getSuccessors();
+            live.assign(slotCount, isExit(blocks[i]));
+            for (int j = 0; j < succs.size(); j++)
+            {
+                vector<bool> &succIn = in[succs[j]->getId()];
+                for (int k = 0; k < slotCount; k++)
+                {
+                    if (succIn[k])
+                        live[k] = true;
+                }
+            }
+            if (transferLiveness(blocks[i], live, reservedCount, true))
+                found = true;
+        }
+    }
+}
+
+/*
+ * Function: getExpressions
+ * ------------------------
+ * Returns the expression trees of stmt in the order they run.
+ */
+
+static vector<Expression *> getExpressions(Statement *stmt)
+{
+    vector<Expression *> exps;
+    if (stmt->getType() == LET)
+        exps.push_back(((SeqLET *)stmt)->getExp());
+    else if (stmt->getType() == PRINT)
+        exps.push_back(((SeqPRINT *)stmt)->getExp());
+    else if (stmt->getType() == IF)
+    {
+        exps.push_back(((ControlIF *)stmt)->getLHS());
+        exps.push_back(((ControlIF *)stmt)->getRHS());
+    }
+    return exps;
+}
+
+/*
+ * Function: meetCopies
+ * --------------------
+ * Sets c.source to the copies available at the start of block: those
+ * the visited predecessors agree on, or none at all for the entry
+ * block.  Returns false if no predecessor has been visited yet.
+ */
+
+static bool meetCopies(ControlFlowGraph &cfg, BasicBlock *block, vector<vector<int> > &out, vector<bool> &visited, Copies &c)
+{
+    int slotCount = c.source.size();
+    bool known = block == cfg.getEntry();
+    vector<BasicBlock *> &preds = block->getPredecessors();
+    for (int i = 0; i < preds.size() && block != cfg.getEntry(); i++)
+    {
+        vector<int> &predOut = out[preds[i]->getId()];
+        if (!visited[preds[i]->getId()])
+            continue;
+        if (!known)
+            c.source = predOut;
+        for (int j = 0; known && j < slotCount; j++)
+        {
+            if (c.source[j] != predOut[j])
+                c.source[j] = -1;
+        }
+        known = true;
+    }
+    if (!known || block == cfg.getEntry())
+        c.source.assign(slotCount, -1);
+    return known;
+}
+
+static void clearExp(Expression *exp)
+{
+    if (exp->getType() == IDENTIFIER)
+        ((IdentifierExp *)exp)->setCopyOf(-1);
+    else if (exp->getType() == COMPOUND)
+    {
+        clearExp(((CompoundExp *)exp)->getLHS());
+        clearExp(((CompoundExp *)exp)->getRHS());
+    }
+}
+
+/*
+ * Function: transferStatement
+ * ---------------------------
+ * Updates c.source across one statement.  A LET p = x records the copy
+ * after the assignment has killed the old copies of p, and copies the
+ * source of x if x is itself a copy.
+ */
+
+static void transferStatement(Statement *stmt, Copies &c)
+{
+    switch (stmt->getType())
+    {
+    case LET:
+    {
+        Expression *exp = ((SeqLET *)stmt)->getExp();
+        int source = -1;
+        if (isStore(stmt, c.reservedCount))
+        {
+            Expression *rhs = ((CompoundExp *)exp)->getRHS();
+            if (rhs->getType() == IDENTIFIER && ((IdentifierExp *)rhs)->isProvenDefined())
+            {
+                source = ((IdentifierExp *)rhs)->getSlot();
+                if (c.source[source] >= 0)
+                    source = c.source[source];
+            }
+        }
+        transferExp(exp, c);
+        if (source >= 0)
+        {
+            int slot = ((IdentifierExp *)((CompoundExp *)exp)->getLHS())->getSlot();
+            if (source != slot)
+                c.source[slot] = source;
+        }
+        break;
+    }
+    case PRINT:
+        transferExp(((SeqPRINT *)stmt)->getExp(), c);
+        break;
+    case INPUT:
+    {
+        int slot = ((SeqINPUT *)stmt)->getSlot();
+        if (slot >= c.reservedCount)
+            kill(slot, c);
+        break;
+    }
+    case IF:
+        transferExp(((ControlIF *)stmt)->getLHS(), c);
+        transferExp(((ControlIF *)stmt)->getRHS(), c);
+        break;
+    default:
+        break;
+    }
+}
+
+static void transferExp(Expression *exp, Copies &c)
+{
+    if (exp->getType() == IDENTIFIER)
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        int source = c.source[id->getSlot()];
+        if (c.mark && source >= 0 && id->isProvenDefined())
+            id->setCopyOf(source);
+        return;
+    }
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+            return;
+        transferExp(cexp->getRHS(), c);
+        int slot = ((IdentifierExp *)cexp->getLHS())->getSlot();
+        if (slot >= c.reservedCount)
+            kill(slot, c);
+        return;
+    }
+    transferExp(cexp->getLHS(), c);
+    transferExp(cexp->getRHS(), c);
+}
+
+static void kill(int slot, Copies &c)
+{
+    c.source[slot] = -1;
+    for (int i = 0; i < c.source.size(); i++)
+    {
+        if (c.source[i] == slot)
+            c.source[i] = -1;
+    }
+}
+
+/*
+ * Function: isExit
+ * ----------------
+ * Returns true if the program can stop at the end of block: at an END,
+ * or by running past its last line, which an IF whose target exists
+ * does when its test fails.
+ */
+
+static bool isExit(BasicBlock *block)
+{
+    Statement *last = block->getLast();
+    if (last->getType() == END)
+        return true;
+    return block->getFallthrough() == NULL && !(last->getType() == GOTO && block->getBranch() != NULL);
+}
+
+/*
+ * Function: isStore
+ * -----------------
+ * Returns true if stmt is a LET v = exp that assigns a variable other
+ * than a keyword.
+ */
+
+static bool isStore(Statement *stmt, int reservedCount)
+{
+    if (stmt->getType() != LET)
+        return false;
+    Expression *exp = ((SeqLET *)stmt)->getExp();
+    if (exp->getType() != COMPOUND || ((CompoundExp *)exp)->getOperator() != ASSIGN_OP)
+        return false;
+    Expression *lhs = ((CompoundExp *)exp)->getLHS();
+    return lhs->getType() == IDENTIFIER && ((IdentifierExp *)lhs)->getSlot() >= reservedCount;
+}
+
+/*
+ * Function: isPure
+ * ----------------
+ * Returns true if evaluating exp can neither print, assign nor trap:
+ * it reads only variables proven defined and divides only by constants
+ * other than 0 and -1.
+ */
+
+static bool isPure(Expression *exp)
+{
+    if (exp->getType() == IDENTIFIER)
+        return ((IdentifierExp *)exp)->isProvenDefined();
+    if (exp->getType() != COMPOUND)
+        return true;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    switch (cexp->getOperator())
+    {
+    case ADD_OP:
+    case SUB_OP:
+    case MUL_OP:
+        return isPure(cexp->getLHS()) && isPure(cexp->getRHS());
+    case DIV_OP:
+    {
+        Expression *rhs = cexp->getRHS();
+        if (rhs->getType() != CONSTANT)
+            return false;
+        int divisor = ((ConstantExp *)rhs)->getValue();
+        return divisor != 0 && divisor != -1 && isPure(cexp->getLHS());
+    }
+    default:
+        return false;
+    }
+}
+
+static void collectEvents(Expression *exp, int reservedCount, vector<Event> &events)
+{
+    if (exp->getType() == IDENTIFIER)
+    {
+        Event read = {false, ((IdentifierExp *)exp)->getSlot()};
+        events.push_back(read);
+        return;
+    }
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+            return;
+        collectEvents(cexp->getRHS(), reservedCount, events);
+        int slot = ((IdentifierExp *)cexp->getLHS())->getSlot();
+        if (slot >= reservedCount)
+        {
+            Event write = {true, slot};
+            events.push_back(write);
+        }
+        return;
+    }
+    collectEvents(cexp->getLHS(), reservedCount, events);
+    collectEvents(cexp->getRHS(), reservedCount, events);
+}
+
+static void collectEvents(Statement *stmt, int reservedCount, vector<Event> &events)
+{
+    if (stmt->getType() == INPUT)
+    {
+        int slot = ((SeqINPUT *)stmt)->getSlot();
+        if (slot >= reservedCount)
+        {
+            Event write = {true, slot};
+            events.push_back(write);
+        }
+        return;
+    }
+    vector<Expression *> exps = getExpressions(stmt);
+    for (int i = 0; i < exps.size(); i++)
+        collectEvents(exps[i], reservedCount, events);
+}
+
+/*
+ * Function: transferLiveness
+ * --------------------------
+ * Walks block backward from live, the variables live at its end, and
+ * leaves the variables live at its start.  Stores already marked dead
+ * are skipped.  If mark is true, a pure store to a variable that is not
+ * live after it is marked dead, and the return value tells whether any
+ * was.
+ */
+
+static bool transferLiveness(BasicBlock *block, vector<bool> &live, int reservedCount, bool mark)
+{
+    bool found = false;
+    vector<Statement *> &stmts = block->getStatements();
+    vector<Event> events;
+    for (int i = stmts.size() - 1; i >= 0; i--)
+    {
+        Statement *stmt = stmts[i];
+        if (stmt->getType() == LET && ((SeqLET *)stmt)->isDead())
+            continue;
+        if (mark && isStore(stmt, reservedCount))
+        {
+            CompoundExp *exp = (CompoundExp *)((SeqLET *)stmt)->getExp();
+            int slot = ((IdentifierExp *)exp->getLHS())->getSlot();
+            if (!live[slot] && isPure(exp->getRHS()))
+            {
+                ((SeqLET *)stmt)->setDead(true);
+                found = true;
+                continue;
+            }
+        }
+        events.clear();
+        collectEvents(stmt, reservedCount, events);
+        for (int j = events.size() - 1; j >= 0; j--)
+            live[events[j].slot] = !events[j].write;
+    }
+    return found;
+}
@@ -0,0 +1,55 @@
+/*
+ * File: copies.h
+ * --------------
+ * This interface exports copy propagation and dead-store elimination,
+ * which together remove the assignments whose values are never used.
+ */
+
+#ifndef _copies_h
+#define _copies_h
+
+#include "cfg.h"
+using namespace std;
+
+/*
+ * Function: clearCopies
+ * Usage: clearCopies(cfg);
+ * ------------------------
+ * Undoes the copy propagation of an earlier RUN, so that every read in
+ * cfg uses the slot of its own variable again.  This has to come before
+ * any other analysis of the program.
+ */
+
+void clearCopies(ControlFlowGraph &cfg);
+
+/*
+ * Function: propagateCopies
+ * Usage: propagateCopies(cfg, slotCount, reservedCount);
+ * ------------------------------------------------------
+ * Finds the statements LET p = x that copy a variable proven defined,
+ * and makes every read of p that such a copy reaches on all paths,
+ * with neither p nor x assigned in between, read x instead.  The read
+ * is marked with setCopyOf, which is exactly as if x had been written
+ * in the program, so the later analyses and every backend see x.
+ * slotCount is the size of the program's SymbolTable and reservedCount
+ * the number of keyword slots.  The definedness analysis must have run
+ * on cfg.
+ */
+
+void propagateCopies(ControlFlowGraph &cfg, int slotCount, int reservedCount);
+
+/*
+ * Function: eliminateDeadStores
+ * Usage: eliminateDeadStores(cfg, slotCount, reservedCount);
+ * ----------------------------------------------------------
+ * Marks with setDead every statement LET v = exp whose value is
+ * assigned again on every path before it is read, provided that
+ * evaluating exp can neither print nor fail, and unmarks every other
+ * LET.  All variables count as read when the program stops, since
+ * the REPL can still print them, so a store is only dead if it is
+ * overwritten on the way to every exit.
+ */
+
+void eliminateDeadStores(ControlFlowGraph &cfg, int slotCount, int reservedCount);
+
+#endif
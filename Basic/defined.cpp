@@ -0,0 +1,149 @@
+/*
+ * File: defined.cpp
+ * -----------------
+ * This file implements the definedness analysis.
+ */
+
+#include "defined.h"
+#include "cfg.h"
+#include "exp.h"
+#include "statement.h"
+#include <vector>
+using namespace std;
+
+/*
+ * Implementation notes: analyzeDefinedness
+ * ----------------------------------------
+ * This is a forward "must" dataflow problem over the basic blocks.
+ * A variable never becomes undefined again while a program runs, so
+ * the set at the entry block is just entryDefined, and every other
+ * block starts from the full set and is narrowed to the intersection
+ * of its predecessors until nothing changes.  A last pass over every
+ * block, reachable or not, replays the transfer function and writes
+ * the marks; reads in unreachable blocks end up proven, which is
+ * harmless since they never run.
+ */
+
+struct Definedness
+{
+    vector<bool> defined;
+    int reservedCount;
+    bool mark;
+};
+
+static void transferExp(Expression *exp, Definedness &d);
+static void transferStatement(Statement *stmt, Definedness &d);
+
+void analyzeDefinedness(ControlFlowGraph &cfg, const vector<bool> &entryDefined, int reservedCount)
+{
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    int n = blocks.size();
+    vector<vector<bool> > in(n, vector<bool>(entryDefined.size(), true));
+    vector<vector<bool> > out(n, vector<bool>(entryDefined.size(), true));
+    BasicBlock *entry = cfg.getEntry();
+    if (entry != NULL)
+        in[entry->getId()] = entryDefined;
+
+    Definedness d;
+    d.reservedCount = reservedCount;
+    d.mark = false;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < n; i++)
+        {
+            BasicBlock *block = blocks[i];
+            if (block != entry)
+            {
+                vector<BasicBlock *> &preds = block->getPredecessors();
+                for (int j = 0; j < preds.size(); j++)
+                {
+                    vector<bool> &predOut = out[preds[j]->getId()];
+                    for (int k = 0; k < predOut.size(); k++)
+                    {
+                        if (!predOut[k])
+                            in[i][k] = false;
+                    }
+                }
+            }
+            d.defined = in[i];
+            vector<Statement *> &stmts = block->getStatements();
+            for (int j = 0; j < stmts.size(); j++)
+                transferStatement(stmts[j], d);
+            if (d.defined != out[i])
+            {
+                out[i] = d.defined;
+                changed = true;
+            }
+        }
+    }
+
+    d.mark = true;
+    for (int i = 0; i < n; i++)
+    {
+        d.defined = in[i];
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+            transferStatement(stmts[j], d);
+    }
+}
+
+/*
+ * Function: transferStatement
+ * ---------------------------
+ * Updates d.defined across one statement, visiting its expressions in
+ * the order they are evaluated.
+ */
+
+static void transferStatement(Statement *stmt, Definedness &d)
+{
+    switch (stmt->getType())
+    {
+    case LET:
+        transferExp(((SeqLET *)stmt)->getExp(), d);
+        break;
+    case PRINT:
+        transferExp(((SeqPRINT *)stmt)->getExp(), d);
+        break;
+    case INPUT:
+    {
+        int slot = ((SeqINPUT *)stmt)->getSlot();
+        if (slot >= d.reservedCount)
+            d.defined[slot] = true;
+        break;
+    }
+    case IF:
+        transferExp(((ControlIF *)stmt)->getLHS(), d);
+        transferExp(((ControlIF *)stmt)->getRHS(), d);
+        break;
+    default:
+        break;
+    }
+}
+
+static void transferExp(Expression *exp, Definedness &d)
+{
+    if (exp->getType() == IDENTIFIER)
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        if (d.mark)
+            id->setProvenDefined(d.defined[id->getSlot()]);
+        return;
+    }
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+            return;
+        transferExp(cexp->getRHS(), d);
+        int slot = ((IdentifierExp *)cexp->getLHS())->getSlot();
+        if (slot >= d.reservedCount)
+            d.defined[slot] = true;
+        return;
+    }
+    transferExp(cexp->getLHS(), d);
+    transferExp(cexp->getRHS(), d);
+}
@@ -0,0 +1,31 @@
+/*
+ * File: defined.h
+ * ---------------
+ * This interface exports the definedness analysis, which finds the
+ * variable reads that can never report VARIABLE NOT DEFINED.
+ */
+
+#ifndef _defined_h
+#define _defined_h
+
+#include "cfg.h"
+#include <vector>
+using namespace std;
+
+/*
+ * Function: analyzeDefinedness
+ * Usage: analyzeDefinedness(cfg, entryDefined, reservedCount);
+ * ------------------------------------------------------------
+ * Computes, for every point of the program, the variables that are
+ * defined on all paths from the entry block of cfg, and marks each
+ * IdentifierExp that reads one of them with setProvenDefined.  Every
+ * other read is marked unproven, so the marks of an earlier RUN never
+ * survive.  entryDefined has one element per slot of the program's
+ * SymbolTable and tells whether that variable is already defined when
+ * the program starts.  reservedCount is the number of keyword slots,
+ * which assignments never define.
+ */
+
+void analyzeDefinedness(ControlFlowGraph &cfg, const vector<bool> &entryDefined, int reservedCount);
+
+#endif
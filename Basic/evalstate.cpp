@@ -7,47 +7,117 @@
  */
 
 #include "evalstate.h"
-#include <set>
+#include "symtab.h"
+#include <iostream>
 #include <string>
-
-#include "../StanfordCPPLib/map.h"
+#include <vector>
 using namespace std;
 
-/* A set of key words */
-
-set<string> words = {"REM", "LET", "PRINT", "INPUT", "END", "GOTO", "IF", "THEN", "RUN", "LIST", "CLEAR", "QUIT", "HELP"};
-
 /* Implementation of the EvalState class */
 
+EvalState::EvalState()
+{
+    symbols = &ownSymbols;
+    mode = BYTECODE_VM;
+    reportingIdioms = false;
+    reportingSuperinstructions = false;
+    reportingMemory = false;
+}
+
 EvalState::~EvalState()
 {
-    symbolTable.clear();
+    clear();
+}
+
+void EvalState::setSymbolTable(SymbolTable *symbols)
+{
+    this->symbols = symbols;
+    clear();
 }
 
 void EvalState::setValue(string var, int value)
 {
-    if (words.count(var)==1)
+    setValue(symbols->intern(var), value);
+}
+
+void EvalState::setValue(int slot, int value)
+{
+    if (slot < symbols->getReservedCount())
     {
         cout << "SYNTAX ERROR" << endl;
         return;
     }
-    if (symbolTable.containsKey(var))
-        symbolTable[var] = value;
-    else
-        symbolTable.put(var, value);
+    if (slot >= (int)values.size())
+        grow(slot);
+    values[slot] = value;
+    defined[slot] = true;
 }
 
 int EvalState::getValue(string var)
 {
-    return symbolTable.get(var);
+    int slot = symbols->lookup(var);
+    if (slot == -1)
+        return 0;
+    return getValue(slot);
 }
 
 bool EvalState::isDefined(string var)
 {
-    return symbolTable.containsKey(var);
+    int slot = symbols->lookup(var);
+    return slot != -1 && isDefined(slot);
 }
 
 void EvalState::clear()
 {
-    symbolTable.clear();
-}
\ No newline at end of file
+    values.clear();
+    defined.clear();
+}
+
+void EvalState::grow(int slot)
+{
+    int size = 2 * values.size();
+    if (size <= slot)
+        size = slot + 1;
+    values.resize(size, 0);
+    defined.resize(size, false);
+}
+
+ExecutionMode EvalState::getExecutionMode()
+{
+    return mode;
+}
+
+void EvalState::setExecutionMode(ExecutionMode mode)
+{
+    this->mode = mode;
+}
+
+bool EvalState::isReportingIdioms()
+{
+    return reportingIdioms;
+}
+
+void EvalState::setReportingIdioms(bool flag)
+{
+    reportingIdioms = flag;
+}
+
+bool EvalState::isReportingSuperinstructions()
+{
+    return reportingSuperinstructions;
+}
+
+void EvalState::setReportingSuperinstructions(bool flag)
+{
+    reportingSuperinstructions = flag;
+}
+
+bool EvalState::isReportingMemory()
+{
+    return reportingMemory;
+}
+
+void EvalState::setReportingMemory(bool flag)
+{
+    reportingMemory = flag;
+}
@@ -9,8 +9,29 @@
 #ifndef _evalstate_h
 #define _evalstate_h
 
-#include "../StanfordCPPLib/map.h"
+#include "symtab.h"
 #include <string>
+#include <vector>
+
+/*
+ * Type: ExecutionMode
+ * --------------------
+ * This enumerated type selects how RUN executes a program: by walking
+ * the parsed statements (TREE_WALKER), or by compiling them to bytecode
+ * for the stack VM with a switch dispatch loop (BYTECODE_VM) or a
+ * direct-threaded one (THREADED_VM), or by compiling them to
+ * three-address code for the register machine (REGISTER_VM) and
+ * from there to x86-64 machine code (NATIVE_JIT).
+ */
+
+enum ExecutionMode
+{
+  TREE_WALKER,
+  BYTECODE_VM,
+  THREADED_VM,
+  REGISTER_VM,
+  NATIVE_JIT
+};
 
 /*
  * Class: EvalState
@@ -18,10 +39,13 @@
  * This class is passed by reference through the recursive levels
  * of the evaluator and contains information from the evaluation
  * environment that the evaluator may need to know.  In this
- * version, the only information maintained by the EvalState class
- * is a symbol table that maps variable names into their values.
- * Several of the exercises, however, require you to include
- * additional information in the EvalState class.
+ * version, the EvalState class maintains the values of the variables
+ * together with the execution mode used by RUN.
+ *
+ * Values are stored by slot, as numbered by a SymbolTable, in a dense
+ * array with a bitmap of the slots that have been assigned.  The
+ * evaluator uses the slot methods; the name methods are a slower path
+ * kept for callers that only know the name.
  */
 
 class EvalState
@@ -35,7 +59,7 @@ public:
  * Creates a new EvalState object with no variable bindings.
  */
 
-  EvalState(){};
+  EvalState();
 
   /*
  * Destructor: ~EvalState
@@ -46,44 +70,139 @@ public:
 
   ~EvalState();
 
+  /*
+ * Method: setSymbolTable
+ * Usage: state.setSymbolTable(&program.getSymbolTable());
+ * -----------------------------------------------------
+ * Makes the name methods use the slots of the specified table, which
+ * must be the one the evaluated expressions were parsed with.  By
+ * default the state uses a table of its own.
+ */
+
+  void setSymbolTable(SymbolTable *symbols);
+
   /*
  * Method: setValue
  * Usage: state.setValue(var, value);
+ *        state.setValue(slot, value);
  * ----------------------------------
- * Sets the value associated with the specified var.
+ * Sets the value associated with the specified var or slot.  Keywords
+ * cannot be assigned and report SYNTAX ERROR.
  */
 
   void setValue(std::string var, int value);
+  void setValue(int slot, int value);
 
   /*
  * Method: getValue
  * Usage: int value = state.getValue(var);
+ *        int value = state.getValue(slot);
  * ---------------------------------------
- * Returns the value associated with the specified variable.
+ * Returns the value associated with the specified variable or slot.
+ * A slot must be defined; the name version returns 0 otherwise.
  */
 
   int getValue(std::string var);
+  int getValue(int slot);
 
   /*
  * Method: isDefined
  * Usage: if (state.isDefined(var)) . . .
+ *        if (state.isDefined(slot)) . . .
  * --------------------------------------
- * Returns true if the specified variable is defined.
+ * Returns true if the specified variable or slot is defined.
  */
 
   bool isDefined(std::string var);
+  bool isDefined(int slot);
 
   /*
  * Method: clear
  * Usage: state.clear();
  * -----------------------
- * Removes all the contents in symbolTable.
+ * Removes the values of all the variables.
  */
 
   void clear();
 
+  /*
+ * Methods: getExecutionMode, setExecutionMode
+ * Usage: ExecutionMode mode = state.getExecutionMode();
+ *        state.setExecutionMode(mode);
+ * -----------------------
+ * Reads or changes the default execution mode of RUN.  The mode is
+ * not affected by clear.
+ */
+
+  ExecutionMode getExecutionMode();
+  void setExecutionMode(ExecutionMode mode);
+
+  /*
+ * Methods: isReportingIdioms, setReportingIdioms
+ * Usage: if (state.isReportingIdioms()) . . .
+ *        state.setReportingIdioms(flag);
+ * -----------------------
+ * Reads or changes whether RUN lists the idioms it fused on cerr.
+ * The setting is not affected by clear.
+ */
+
+  bool isReportingIdioms();
+  void setReportingIdioms(bool flag);
+
+/*
+ * Methods: isReportingSuperinstructions, setReportingSuperinstructions
+ * Usage: if (state.isReportingSuperinstructions()) . . .
+ *        state.setReportingSuperinstructions(flag);
+ * -----------------------
+ * Reads or changes whether RUN lists on cerr how often each
+ * superinstruction of the bytecode VM fired.  The setting is not
+ * affected by clear.
+ */
+
+  bool isReportingSuperinstructions();
+  void setReportingSuperinstructions(bool flag);
+
+/*
+ * Methods: isReportingMemory, setReportingMemory
+ * Usage: if (state.isReportingMemory()) . . .
+ *        state.setReportingMemory(flag);
+ * -----------------------
+ * Reads or changes whether RUN reports on cerr how much memory the
+ * parsed program takes.  The setting is not affected by clear.
+ */
+
+  bool isReportingMemory();
+  void setReportingMemory(bool flag);
+
 private:
-  Map<string, int> symbolTable;
+  void grow(int slot);
+
+  vector<int> values;
+  vector<bool> defined;
+  SymbolTable ownSymbols;
+  SymbolTable *symbols;
+  ExecutionMode mode;
+  bool reportingIdioms;
+  bool reportingSuperinstructions;
+  bool reportingMemory;
 };
 
+/*
+ * Implementation notes: slot access
+ * ---------------------------------
+ * The slot methods are defined here so that the evaluator can inline
+ * them.  A slot past the end of the arrays has simply not been
+ * assigned yet; setValue grows the arrays on demand.
+ */
+
+inline bool EvalState::isDefined(int slot)
+{
+  return slot < (int)defined.size() && defined[slot];
+}
+
+inline int EvalState::getValue(int slot)
+{
+  return values[slot];
+}
+
 #endif
@@ -12,6 +12,28 @@
 
 using namespace std;
 
+/*
+ * Implementation notes: new and delete
+ * ------------------------------------
+ * Nodes are allocated without a destroy function, so the arena packs
+ * them with no header in front.  Neither delete has anything to do:
+ * the memory belongs to the arena, and the plain one only exists
+ * because the virtual destructor requires it.
+ */
+
+void *Expression::operator new(size_t size, Arena &arena)
+{
+    return arena.allocate(size, NULL);
+}
+
+void Expression::operator delete(void *ptr, Arena &arena)
+{
+}
+
+void Expression::operator delete(void *ptr)
+{
+}
+
 /*
  * Implementation notes: the ConstantExp subclass
  * ----------------------------------------------
@@ -31,7 +53,7 @@ int ConstantExp::eval(EvalState &state, int &flag)
     return value;
 }
 
-string ConstantExp::toString()
+string ConstantExp::toString(SymbolTable &symbols)
 {
     return integerToString(value);
 }
@@ -49,31 +71,34 @@ int ConstantExp::getValue()
 /*
  * Implementation notes: the IdentifierExp subclass
  * ------------------------------------------------
- * The IdentifierExp subclass declares a single instance variable that
- * stores the name of the variable.  The implementation of eval must
- * look this variable up in the evaluation state.
+ * The IdentifierExp subclass stores the slot the parser resolved the
+ * variable to.  The implementation of eval reads the slot directly
+ * from the evaluation state; the name is only needed by toString,
+ * which looks it up in the symbol table.
  */
 
-IdentifierExp::IdentifierExp(string name)
+IdentifierExp::IdentifierExp(int slot)
 {
-    this->name = name;
+    this->slot = slot;
+    variableSlot = slot;
+    provenDefined = false;
 }
 
 int IdentifierExp::eval(EvalState &state, int &flag)
 {
-    if (!state.isDefined(name))
+    if (!provenDefined && !state.isDefined(slot))
     {
         cout << "VARIABLE NOT DEFINED\n";
         flag = 0;
         return 0;
     }
     flag = 1;
-    return state.getValue(name);
+    return state.getValue(slot);
 }
 
-string IdentifierExp::toString()
+string IdentifierExp::toString(SymbolTable &symbols)
 {
-    return name;
+    return symbols.getName(variableSlot);
 }
 
 ExpressionType IdentifierExp::getType()
@@ -81,9 +106,29 @@ ExpressionType IdentifierExp::getType()
     return IDENTIFIER;
 }
 
-string IdentifierExp::getName()
+string IdentifierExp::getName(SymbolTable &symbols)
+{
+    return symbols.getName(variableSlot);
+}
+
+int IdentifierExp::getSlot()
+{
+    return slot;
+}
+
+void IdentifierExp::setProvenDefined(bool proven)
+{
+    provenDefined = proven;
+}
+
+bool IdentifierExp::isProvenDefined()
 {
-    return name;
+    return provenDefined;
+}
+
+void IdentifierExp::setCopyOf(int slot)
+{
+    this->slot = slot >= 0 ? slot : variableSlot;
 }
 
 /*
@@ -94,17 +139,28 @@ string IdentifierExp::getName()
  * evaluates the subexpressions recursively and then applies the operator.
  */
 
+/*
+ * Implementation notes: operator names
+ * ------------------------------------
+ * OPERATOR_NAMES maps an OperatorType back to the string the parser
+ * read, which getOp and toString still return.
+ */
+
+static const string OPERATOR_NAMES[] = {"=", "+", "-", "*", "/", "?"};
+
 CompoundExp::CompoundExp(string op, Expression *lhs, Expression *rhs)
 {
-    this->op = op;
+    this->op = UNKNOWN_OP;
+    for (int i = ASSIGN_OP; i < UNKNOWN_OP; i++)
+    {
+        if (op == OPERATOR_NAMES[i])
+            this->op = i;
+    }
     this->lhs = lhs;
     this->rhs = rhs;
-}
-
-CompoundExp::~CompoundExp()
-{
-    delete lhs;
-    delete rhs;
+    divisorNonzero = false;
+    hoistedSlot = -1;
+    remainder = false;
 }
 
 /*
@@ -113,11 +169,24 @@ CompoundExp::~CompoundExp()
  * The eval method for the compound expression case must check for the
  * assignment operator as a special case.  Unlike the arithmetic operators
  * the assignment operator does not evaluate its left operand.
+ *
+ * A remainder idiom gives what its three nodes would: q when p is 0,
+ * after the DIVIDE BY ZERO message, and the flag of p, which is 1.
  */
 
 int CompoundExp::eval(EvalState &state, int &flag)
 {
-    if (op == "=")
+    if (hoistedSlot >= 0)
+    {
+        flag = 1;
+        return state.getValue(hoistedSlot);
+    }
+    return compute(state, flag);
+}
+
+int CompoundExp::compute(EvalState &state, int &flag)
+{
+    if (op == ASSIGN_OP)
     {
         if (lhs->getType() != IDENTIFIER)
         {
@@ -126,21 +195,33 @@ int CompoundExp::eval(EvalState &state, int &flag)
             return 0;
         }
         int val = rhs->eval(state, flag);
-        state.setValue(((IdentifierExp *)lhs)->getName(), val);
+        state.setValue(((IdentifierExp *)lhs)->getSlot(), val);
         flag = 1;
         return val;
     }
+    if (remainder)
+    {
+        int left = lhs->eval(state, flag);
+        int right = getRemainderDivisor()->eval(state, flag);
+        if (right == 0)
+        {
+            cout << "DIVIDE BY ZERO\n";
+            return left;
+        }
+        return left % right;
+    }
     int left = lhs->eval(state, flag);
     int right = rhs->eval(state, flag);
-    if (op == "+")
+    switch (op)
+    {
+    case ADD_OP:
         return left + right;
-    if (op == "-")
+    case SUB_OP:
         return left - right;
-    if (op == "*")
+    case MUL_OP:
         return left * right;
-    if (op == "/")
-    {
-        if (right == 0)
+    case DIV_OP:
+        if (!divisorNonzero && right == 0)
         {
             cout << "DIVIDE BY ZERO\n";
             flag = 0;
@@ -148,15 +229,17 @@ int CompoundExp::eval(EvalState &state, int &flag)
         }
         flag = 1;
         return left / right;
+    default:
+        break;
     }
     cout << "SYNTAX ERROR\n";
     flag = 0;
     return 0;
 }
 
-string CompoundExp::toString()
+string CompoundExp::toString(SymbolTable &symbols)
 {
-    return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+    return '(' + lhs->toString(symbols) + ' ' + OPERATOR_NAMES[op] + ' ' + rhs->toString(symbols) + ')';
 }
 
 ExpressionType CompoundExp::getType()
@@ -166,7 +249,12 @@ ExpressionType CompoundExp::getType()
 
 string CompoundExp::getOp()
 {
-    return op;
+    return OPERATOR_NAMES[op];
+}
+
+OperatorType CompoundExp::getOperator()
+{
+    return (OperatorType)op;
 }
 
 Expression *CompoundExp::getLHS()
@@ -178,3 +266,58 @@ Expression *CompoundExp::getRHS()
 {
     return rhs;
 }
+
+void CompoundExp::setLHS(Expression *lhs)
+{
+    this->lhs = lhs;
+}
+
+void CompoundExp::setRHS(Expression *rhs)
+{
+    this->rhs = rhs;
+}
+
+void CompoundExp::setDivisorNonzero(bool proven)
+{
+    divisorNonzero = proven;
+}
+
+bool CompoundExp::isDivisorNonzero()
+{
+    return divisorNonzero;
+}
+
+void CompoundExp::setHoistedSlot(int slot)
+{
+    hoistedSlot = slot;
+}
+
+int CompoundExp::getHoistedSlot()
+{
+    return hoistedSlot;
+}
+
+void CompoundExp::setRemainder(bool idiom)
+{
+    remainder = idiom;
+}
+
+bool CompoundExp::isRemainder()
+{
+    return remainder;
+}
+
+/*
+ * Implementation notes: getRemainderDivisor
+ * -----------------------------------------
+ * The right operand of a remainder is the product of the quotient and
+ * p, in either order, and p is the factor that is not compound.
+ */
+
+Expression *CompoundExp::getRemainderDivisor()
+{
+    CompoundExp *product = (CompoundExp *)rhs;
+    if (product->lhs->getType() == COMPOUND)
+        return product->rhs;
+    return product->lhs;
+}
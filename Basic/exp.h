@@ -9,7 +9,9 @@
 #ifndef _exp_h
 #define _exp_h
 
+#include "arena.h"
 #include "evalstate.h"
+#include "symtab.h"
 
 /*
  * Type: ExpressionType
@@ -25,6 +27,24 @@ enum ExpressionType
   COMPOUND
 };
 
+/*
+ * Type: OperatorType
+ * ------------------
+ * This enumerated type identifies the operator of a CompoundExp, so
+ * that evaluation dispatches on an integer instead of comparing the
+ * operator string.  UNKNOWN_OP stands for any other operator string.
+ */
+
+enum OperatorType
+{
+  ASSIGN_OP,
+  ADD_OP,
+  SUB_OP,
+  MUL_OP,
+  DIV_OP,
+  UNKNOWN_OP
+};
+
 /*
  * Class: Expression
  * -----------------
@@ -63,15 +83,31 @@ public:
 
 /*
  * Destructor: ~Expression
- * Usage: delete exp;
- * ------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting an expression.
+ * Usage: usually implicit
+ * -----------------------
+ * Expression nodes hold no storage of their own, so the Arena that
+ * holds them frees them without calling the destructor.  It is only
+ * declared virtual because the class has virtual methods.
  */
 
   virtual ~Expression(){};
 
+/*
+ * Operators: new, delete
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
+ * --------------------------------------------------------
+ * Every expression node is allocated in an Arena, normally the one of
+ * the program line it belongs to, and lives exactly as long as that
+ * arena.  Nodes are never deleted on their own; plain new is hidden so
+ * that none can be made outside an arena.  Since nodes are not
+ * destroyed, the arena keeps no bookkeeping for them, and a subclass
+ * must never own anything that needs a destructor, such as a string.
+ */
+
+  static void *operator new(size_t size, Arena &arena);
+  static void operator delete(void *ptr, Arena &arena);
+  static void operator delete(void *ptr);
+
 /*
  * Method: eval
  * Usage: int value = exp->eval(state);
@@ -84,12 +120,13 @@ public:
 
 /*
  * Method: toString
- * Usage: string str = exp->toString();
- * ------------------------------------
- * Returns a string representation of this expression.
+ * Usage: string str = exp->toString(symbols);
+ * -------------------------------------------
+ * Returns a string representation of this expression, taking the
+ * names of its variables from the symbol table it was parsed with.
  */
 
-  virtual std::string toString() = 0;
+  virtual std::string toString(SymbolTable &symbols) = 0;
 
 /*
  * Method: type
@@ -114,7 +151,7 @@ class ConstantExp : public Expression
 public:
 /*
  * Constructor: ConstantExp
- * Usage: Expression *exp = new ConstantExp(value);
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
  * ------------------------------------------------
  * The constructor initializes a new integer constant expression
  * to the given value.
@@ -130,7 +167,7 @@ public:
  */
 
   virtual int eval(EvalState &state, int &flag);
-  virtual std::string toString();
+  virtual std::string toString(SymbolTable &symbols);
   virtual ExpressionType getType();
 
 /*
@@ -159,13 +196,15 @@ class IdentifierExp : public Expression
 public:
 /*
  * Constructor: IdentifierExp
- * Usage: Expression *exp = new IdentifierExp(name);
- * -------------------------------------------------
- * The constructor initializes a new identifier expression
- * for the variable named by name.
+ * Usage: Expression *exp = new (arena) IdentifierExp(slot);
+ * ---------------------------------------------------------
+ * The constructor initializes a new identifier expression for the
+ * variable that the parser has interned into the specified slot of
+ * the program's SymbolTable.  The node keeps only the slot; the name
+ * stays in the table.
  */
 
-  IdentifierExp(std::string name);
+  IdentifierExp(int slot);
 
 /*
  * Prototypes for the virtual methods
@@ -175,21 +214,60 @@ public:
  */
 
   virtual int eval(EvalState &state, int &flag);
-  virtual std::string toString();
+  virtual std::string toString(SymbolTable &symbols);
   virtual ExpressionType getType();
 
 /*
  * Method: getName
- * Usage: string name = ((IdentifierExp *) exp)->getName();
- * --------------------------------------------------------
- * Returns the name field of the identifier node and can be applied only
- * to an object known to be an IdentifierExp.
+ * Usage: string name = ((IdentifierExp *) exp)->getName(symbols);
+ * ---------------------------------------------------------------
+ * Returns the name of the variable, as found in the symbol table the
+ * node was parsed with, and can be applied only to an object known
+ * to be an IdentifierExp.
+ */
+
+  std::string getName(SymbolTable &symbols);
+
+/*
+ * Method: getSlot
+ * Usage: int slot = ((IdentifierExp *) exp)->getSlot();
+ * -----------------------------------------------------
+ * Returns the slot of the variable in the EvalState and can be
+ * applied only to an object known to be an IdentifierExp.
  */
 
-  std::string getName();
+  int getSlot();
+
+/*
+ * Methods: setProvenDefined, isProvenDefined
+ * Usage: ((IdentifierExp *) exp)->setProvenDefined(true);
+ *        if (((IdentifierExp *) exp)->isProvenDefined()) . . .
+ * ---------------------------------------------------------
+ * Record whether the definedness analysis has proven that the
+ * variable is always defined when this node is evaluated, in which
+ * case eval skips the VARIABLE NOT DEFINED check.  Nodes start out
+ * unproven.
+ */
+
+  void setProvenDefined(bool proven);
+  bool isProvenDefined();
+
+/*
+ * Method: setCopyOf
+ * Usage: ((IdentifierExp *) exp)->setCopyOf(slot);
+ * ------------------------------------------------
+ * Makes the node read the variable in the specified slot instead of
+ * its own, once copy propagation has proven that both always hold the
+ * same value here.  From then on getSlot returns the new slot, and
+ * setCopyOf(-1) returns the node to its own variable.
+ */
+
+  void setCopyOf(int slot);
 
 private:
-  std::string name;
+  int slot;
+  int variableSlot;
+  bool provenDefined;
 };
 
 /*
@@ -205,11 +283,12 @@ class CompoundExp : public Expression
 public:
 /*
  * Constructor: CompoundExp
- * Usage: Expression *exp = new CompoundExp(op, lhs, rhs);
+ * Usage: Expression *exp = new (arena) CompoundExp(op, lhs, rhs);
  * -------------------------------------------------------
  * The constructor initializes a new compound expression
  * which is composed of the operator (op) and the left and
- * right subexpression (lhs and rhs).
+ * right subexpression (lhs and rhs).  The operator string is
+ * translated into an OperatorType once, here.
  */
 
   CompoundExp(std::string op, Expression *lhs, Expression *rhs);
@@ -221,9 +300,8 @@ public:
  * base class and don't require additional documentation.
  */
 
-  virtual ~CompoundExp();
   virtual int eval(EvalState &state, int &flag);
-  virtual std::string toString();
+  virtual std::string toString(SymbolTable &symbols);
   virtual ExpressionType getType();
 
 /*
@@ -240,9 +318,87 @@ public:
   Expression *getLHS();
   Expression *getRHS();
 
+/*
+ * Methods: setLHS, setRHS
+ * Usage: cexp->setLHS(lhs);
+ *        cexp->setRHS(rhs);
+ * ------------------------
+ * These methods replace a subexpression without freeing the old one,
+ * which lets the constant folder rewrite a tree in place.
+ */
+
+  void setLHS(Expression *lhs);
+  void setRHS(Expression *rhs);
+
+/*
+ * Method: getOperator
+ * Usage: OperatorType op = ((CompoundExp *) exp)->getOperator();
+ * --------------------------------------------------------------
+ * Returns the operator as an OperatorType and can be applied only
+ * to an object known to be a CompoundExp.
+ */
+
+  OperatorType getOperator();
+
+/*
+ * Methods: setDivisorNonzero, isDivisorNonzero
+ * Usage: ((CompoundExp *) exp)->setDivisorNonzero(true);
+ *        if (((CompoundExp *) exp)->isDivisorNonzero()) . . .
+ * ---------------------------------------------------------
+ * Record whether the range analysis has proven that the right operand
+ * of this division is never 0, in which case eval skips the DIVIDE BY
+ * ZERO check.  Nodes start out unproven.
+ */
+
+  void setDivisorNonzero(bool proven);
+  bool isDivisorNonzero();
+
+/*
+ * Methods: setHoistedSlot, getHoistedSlot
+ * Usage: ((CompoundExp *) exp)->setHoistedSlot(slot);
+ *        int slot = ((CompoundExp *) exp)->getHoistedSlot();
+ * ---------------------------------------------------------
+ * Record the hidden variable that holds the value of this expression
+ * once loop-invariant code motion has moved it in front of its loop,
+ * or -1 if it is computed where it stands.  A hoisted expression never
+ * fails, so eval just reads the variable and returns the flag 1.
+ */
+
+  void setHoistedSlot(int slot);
+  int getHoistedSlot();
+
+/*
+ * Methods: setRemainder, isRemainder, getRemainderDivisor
+ * Usage: ((CompoundExp *) exp)->setRemainder(true);
+ *        if (((CompoundExp *) exp)->isRemainder()) . . .
+ *        Expression *p = ((CompoundExp *) exp)->getRemainderDivisor();
+ * ---------------------------------------------------------
+ * Record whether the idiom recognizer has found this subtraction to be
+ * the remainder q - q / p * p, or q - p * (q / p), of operands that
+ * are constants or proven variables.  eval then reads q and p once and
+ * divides once.  getRemainderDivisor returns p of a marked node.
+ */
+
+  void setRemainder(bool idiom);
+  bool isRemainder();
+  Expression *getRemainderDivisor();
+
+/*
+ * Method: compute
+ * Usage: int value = cexp->compute(state, flag);
+ * ----------------------------------------------
+ * Evaluates the operator on its operands even if the expression is
+ * hoisted.  This is what the preheader of a loop runs.
+ */
+
+  int compute(EvalState &state, int &flag);
+
 private:
-  std::string op;
   Expression *lhs, *rhs;
+  int hoistedSlot;
+  unsigned char op;
+  bool divisorNonzero;
+  bool remainder;
 };
 
 #endif
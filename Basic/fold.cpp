@@ -0,0 +1,117 @@
+/*
+ * File: fold.cpp
+ * --------------
+ * This file implements the constant folder.
+ */
+
+#include "fold.h"
+#include "exp.h"
+#include <climits>
+using namespace std;
+
+static bool isConstant(Expression *exp, int value);
+static bool evaluate(OperatorType op, int left, int right, int &value);
+
+/*
+ * Implementation notes: foldConstants
+ * -----------------------------------
+ * The operands are folded first, so a whole constant subtree collapses
+ * bottom up.  Since a constant never prints anything and its flag is
+ * 1, replacing an operator by its value is safe exactly when the
+ * operator itself cannot fail.  For the identities, 0 + e and 1 * e
+ * always behave like e, while e + 0, e - 0, e * 1 and e / 1 only do
+ * so if the flag of e is known to be 1.
+ */
+
+Expression *foldConstants(Expression *exp, Arena &arena)
+{
+    if (exp->getType() != COMPOUND)
+        return exp;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    foldOperands(cexp, arena);
+    OperatorType op = cexp->getOperator();
+    Expression *lhs = cexp->getLHS();
+    Expression *rhs = cexp->getRHS();
+    int value;
+    if (lhs->getType() == CONSTANT && rhs->getType() == CONSTANT && evaluate(op, ((ConstantExp *)lhs)->getValue(), ((ConstantExp *)rhs)->getValue(), value))
+        return new (arena) ConstantExp(value);
+    if ((op == ADD_OP && isConstant(lhs, 0)) || (op == MUL_OP && isConstant(lhs, 1)))
+        return rhs;
+    if ((((op == ADD_OP || op == SUB_OP) && isConstant(rhs, 0)) || ((op == MUL_OP || op == DIV_OP) && isConstant(rhs, 1))) && hasConstantFlag(lhs))
+        return lhs;
+    return exp;
+}
+
+void foldOperands(Expression *exp, Arena &arena)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() != ASSIGN_OP)
+        cexp->setLHS(foldConstants(cexp->getLHS(), arena));
+    cexp->setRHS(foldConstants(cexp->getRHS(), arena));
+}
+
+bool hasConstantFlag(Expression *exp)
+{
+    switch (exp->getType())
+    {
+    case CONSTANT:
+        return true;
+    case IDENTIFIER:
+        return ((IdentifierExp *)exp)->isProvenDefined();
+    default:
+        break;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    switch (cexp->getOperator())
+    {
+    case ASSIGN_OP:
+        return cexp->getLHS()->getType() == IDENTIFIER;
+    case ADD_OP:
+    case SUB_OP:
+    case MUL_OP:
+        return hasConstantFlag(cexp->getRHS());
+    case DIV_OP:
+        return cexp->isDivisorNonzero();
+    default:
+        return false;
+    }
+}
+
+static bool isConstant(Expression *exp, int value)
+{
+    return exp->getType() == CONSTANT && ((ConstantExp *)exp)->getValue() == value;
+}
+
+/*
+ * Implementation notes: evaluate
+ * ------------------------------
+ * Computes left op right into value, or returns false if the operator
+ * has to stay in the tree.  Overflow wraps around, as it does on the
+ * machines the interpreter runs on; INT_MIN / -1 traps there, so it is
+ * left for run time as well.
+ */
+
+static bool evaluate(OperatorType op, int left, int right, int &value)
+{
+    switch (op)
+    {
+    case ADD_OP:
+        value = (int)((unsigned)left + (unsigned)right);
+        return true;
+    case SUB_OP:
+        value = (int)((unsigned)left - (unsigned)right);
+        return true;
+    case MUL_OP:
+        value = (int)((unsigned)left * (unsigned)right);
+        return true;
+    case DIV_OP:
+        if (right == 0 || (left == INT_MIN && right == -1))
+            return false;
+        value = left / right;
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * File: fold.h
+ * ------------
+ * This interface exports the constant folder, which simplifies the
+ * expression trees of a program line right after it is parsed.
+ */
+
+#ifndef _fold_h
+#define _fold_h
+
+#include "arena.h"
+#include "exp.h"
+
+/*
+ * Function: foldConstants
+ * Usage: exp = foldConstants(exp, arena);
+ * ---------------------------------------
+ * Simplifies exp and returns the simplified tree, allocating the
+ * constants it makes in arena, which must be the arena of exp; the
+ * nodes it drops stay there until the arena goes.  Operators whose operands are both constants are
+ * replaced by their value, and additions of 0 and multiplications by
+ * 1 are removed, but only where this cannot change what evaluating
+ * the expression prints or the flag it returns: a division by zero
+ * stays in the tree, and so does x + 0, whose flag is 1 even when x is
+ * not defined.
+ */
+
+Expression *foldConstants(Expression *exp, Arena &arena);
+
+/*
+ * Function: foldOperands
+ * Usage: foldOperands(exp, arena);
+ * --------------------------------
+ * Folds the operands of exp but keeps exp itself, for LET, which
+ * complains at run time if its expression is not compound.  The left
+ * side of an assignment is never touched.
+ */
+
+void foldOperands(Expression *exp, Arena &arena);
+
+/*
+ * Function: hasConstantFlag
+ * Usage: if (hasConstantFlag(exp)) . . .
+ * --------------------------------------
+ * Returns true if the flag Expression::eval returns for exp is always
+ * 1.  The flag of +, - and * is the flag of their right operand, so
+ * only the rightmost path of the tree matters.  A variable counts only
+ * once the definedness analysis has proven it, and a division once the
+ * range analysis has proven its divisor nonzero.
+ */
+
+bool hasConstantFlag(Expression *exp);
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * File: idiom.cpp
+ * ---------------
+ * This file implements the IdiomRecognizer class.
+ */
+
+#include "idiom.h"
+#include "exp.h"
+#include "program.h"
+#include "statement.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+static vector<Expression *> getExpressions(Statement *stmt);
+static void unmark(Expression *exp);
+static bool isPure(Expression *exp);
+static bool isSame(Expression *a, Expression *b);
+static bool isRemainder(Expression *exp);
+static int getAssignedSlot(Statement *stmt, Expression *&rhs);
+static bool isProvenVariable(Expression *exp, int slot);
+
+/*
+ * Implementation notes: IdiomRecognizer
+ * -------------------------------------
+ * The program is walked in the order of its links, which is the order
+ * of its lines.  An IF idiom only looks at the statements linked after
+ * the IF, never at the control-flow graph: the fused operation leaves
+ * the state exactly as the path through those statements would, and
+ * every other path into them is untouched.
+ */
+
+IdiomRecognizer::IdiomRecognizer(Program &program, int reservedCount)
+{
+    this->reservedCount = reservedCount;
+    program.link();
+    Statement *first = program.getLinkedStatement(program.getFirstLineNumber());
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        vector<Expression *> exps = getExpressions(stmt);
+        for (int i = 0; i < exps.size(); i++)
+            unmark(exps[i]);
+        if (stmt->getType() == IF)
+        {
+            Idiom none;
+            none.type = NO_IDIOM;
+            ((ControlIF *)stmt)->setIdiom(none);
+        }
+    }
+    for (Statement *stmt = first; stmt != NULL; stmt = stmt->getNext())
+    {
+        if (stmt->getType() == IF)
+            recognizeIF((ControlIF *)stmt);
+        vector<Expression *> exps = getExpressions(stmt);
+        for (int i = 0; i < exps.size(); i++)
+            recognize(exps[i], stmt->getLineNumber());
+    }
+}
+
+void IdiomRecognizer::report(ostream &os)
+{
+    for (int i = 0; i < rewrites.size(); i++)
+        os << "line " << rewrites[i].line << ": " << rewrites[i].name << endl;
+}
+
+void IdiomRecognizer::recognize(Expression *exp, int line)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (isRemainder(cexp))
+    {
+        cexp->setRemainder(true);
+        Rewrite rewrite = {line, "remainder"};
+        rewrites.push_back(rewrite);
+        return;
+    }
+    recognize(cexp->getLHS(), line);
+    recognize(cexp->getRHS(), line);
+}
+
+/*
+ * Method: recognizeIF
+ * -------------------
+ * Matches the IF statement ctrl against the idioms that start with a
+ * conditional jump.  The absolute value and the extremes jump over
+ * exactly one assignment to the variable they compare.
+ */
+
+void IdiomRecognizer::recognizeIF(ControlIF *ctrl)
+{
+    Idiom idiom;
+    idiom.operand = NULL;
+    Rewrite rewrite;
+    rewrite.line = ctrl->getLineNumber();
+    if (isGCDLoop(ctrl, idiom))
+    {
+        rewrite.name = "gcd loop";
+        ctrl->setIdiom(idiom);
+        rewrites.push_back(rewrite);
+        return;
+    }
+    Statement *next = ctrl->getNext();
+    if (ctrl->getTarget() == NULL || next == NULL || next->getNext() != ctrl->getTarget())
+        return;
+    Expression *value;
+    int slot = getAssignedSlot(next, value);
+    if (slot < reservedCount)
+        return;
+    Expression *lhs = ctrl->getLHS();
+    Expression *rhs = ctrl->getRHS();
+    char cmp = ctrl->getCmp();
+    if (isProvenVariable(rhs, slot))
+    {
+        swap(lhs, rhs);
+        cmp = cmp == '<' ? '>' : cmp == '>' ? '<' : cmp;
+    }
+    if (!isProvenVariable(lhs, slot))
+        return;
+    idiom.a = slot;
+    if (isPure(value) && isPure(rhs) && isSame(value, rhs) && (cmp == '<' || cmp == '>'))
+    {
+        idiom.type = cmp == '>' ? MAX_IDIOM : MIN_IDIOM;
+        idiom.operand = value;
+        rewrite.name = cmp == '>' ? "maximum" : "minimum";
+    }
+    else if (cmp == '>' && rhs->getType() == CONSTANT && ((ConstantExp *)rhs)->getValue() == 0 && value->getType() == COMPOUND)
+    {
+        CompoundExp *negation = (CompoundExp *)value;
+        Expression *zero = negation->getLHS();
+        if (negation->getOperator() != SUB_OP || zero->getType() != CONSTANT || ((ConstantExp *)zero)->getValue() != 0)
+            return;
+        if (!isProvenVariable(negation->getRHS(), slot))
+            return;
+        idiom.type = ABS_IDIOM;
+        rewrite.name = "absolute value";
+    }
+    else
+        return;
+    ctrl->setIdiom(idiom);
+    rewrites.push_back(rewrite);
+}
+
+/*
+ * Method: isGCDLoop
+ * -----------------
+ * Returns true if ctrl heads Euclid's algorithm, filling in idiom.
+ * The loop is the IF and the four statements linked after it, and
+ * a, b and t must be three different variables.
+ */
+
+bool IdiomRecognizer::isGCDLoop(ControlIF *ctrl, Idiom &idiom)
+{
+    Expression *lhs = ctrl->getLHS();
+    Expression *rhs = ctrl->getRHS();
+    if (lhs->getType() == CONSTANT)
+        swap(lhs, rhs);
+    if (ctrl->getCmp() != '=' || ctrl->getTarget() == NULL || lhs->getType() != IDENTIFIER)
+        return false;
+    if (rhs->getType() != CONSTANT || ((ConstantExp *)rhs)->getValue() != 0)
+        return false;
+    int b = ((IdentifierExp *)lhs)->getSlot();
+    if (!isProvenVariable(lhs, b))
+        return false;
+
+    Statement *stmts[4];
+    Statement *stmt = ctrl;
+    for (int i = 0; i < 4; i++)
+    {
+        stmt = stmt->getNext();
+        if (stmt == NULL)
+            return false;
+        stmts[i] = stmt;
+    }
+    if (stmts[3]->getType() != GOTO || ((ControlGOTO *)stmts[3])->getTarget() != ctrl)
+        return false;
+    for (int i = 0; i < 4; i++)
+    {
+        if (ctrl->getTarget() == stmts[i])
+            return false;
+    }
+    Expression *remainder, *copy, *last;
+    int t = getAssignedSlot(stmts[0], remainder);
+    int a = getAssignedSlot(stmts[1], copy);
+    if (getAssignedSlot(stmts[2], last) != b || t < reservedCount || a < reservedCount)
+        return false;
+    if (a == b || a == t || b == t || !isRemainder(remainder))
+        return false;
+    CompoundExp *cexp = (CompoundExp *)remainder;
+    if (!isProvenVariable(cexp->getLHS(), a) || !isProvenVariable(cexp->getRemainderDivisor(), b))
+        return false;
+    if (copy->getType() != IDENTIFIER || ((IdentifierExp *)copy)->getSlot() != b)
+        return false;
+    if (last->getType() != IDENTIFIER || ((IdentifierExp *)last)->getSlot() != t)
+        return false;
+    idiom.type = GCD_IDIOM;
+    idiom.a = a;
+    idiom.b = b;
+    idiom.t = t;
+    return true;
+}
+
+/*
+ * Function: getExpressions
+ * ------------------------
+ * Returns the expression trees of stmt in the order they run.
+ */
+
+static vector<Expression *> getExpressions(Statement *stmt)
+{
+    vector<Expression *> exps;
+    if (stmt->getType() == LET)
+        exps.push_back(((SeqLET *)stmt)->getExp());
+    else if (stmt->getType() == PRINT)
+        exps.push_back(((SeqPRINT *)stmt)->getExp());
+    else if (stmt->getType() == IF)
+    {
+        exps.push_back(((ControlIF *)stmt)->getLHS());
+        exps.push_back(((ControlIF *)stmt)->getRHS());
+    }
+    return exps;
+}
+
+static void unmark(Expression *exp)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    cexp->setRemainder(false);
+    unmark(cexp->getLHS());
+    unmark(cexp->getRHS());
+}
+
+/*
+ * Function: isPure
+ * ----------------
+ * Returns true if exp is a constant or a variable proven defined, whose
+ * evaluation can neither print nor change anything.
+ */
+
+static bool isPure(Expression *exp)
+{
+    if (exp->getType() == CONSTANT)
+        return true;
+    return exp->getType() == IDENTIFIER && ((IdentifierExp *)exp)->isProvenDefined();
+}
+
+static bool isSame(Expression *a, Expression *b)
+{
+    if (a->getType() == CONSTANT && b->getType() == CONSTANT)
+        return ((ConstantExp *)a)->getValue() == ((ConstantExp *)b)->getValue();
+    if (a->getType() == IDENTIFIER && b->getType() == IDENTIFIER)
+        return ((IdentifierExp *)a)->getSlot() == ((IdentifierExp *)b)->getSlot();
+    return false;
+}
+
+/*
+ * Function: isRemainder
+ * ---------------------
+ * Returns true if exp is q - q / p * p or q - p * (q / p) for pure
+ * operands q and p.
+ */
+
+static bool isRemainder(Expression *exp)
+{
+    if (exp->getType() != COMPOUND)
+        return false;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() != SUB_OP || cexp->getRHS()->getType() != COMPOUND)
+        return false;
+    CompoundExp *product = (CompoundExp *)cexp->getRHS();
+    if (product->getOperator() != MUL_OP)
+        return false;
+    Expression *quotient = product->getLHS();
+    Expression *divisor = product->getRHS();
+    if (quotient->getType() != COMPOUND)
+        swap(quotient, divisor);
+    if (quotient->getType() != COMPOUND || ((CompoundExp *)quotient)->getOperator() != DIV_OP)
+        return false;
+    CompoundExp *division = (CompoundExp *)quotient;
+    Expression *q = cexp->getLHS();
+    return isPure(q) && isPure(divisor) && isSame(division->getLHS(), q) && isSame(division->getRHS(), divisor);
+}
+
+/*
+ * Function: getAssignedSlot
+ * -------------------------
+ * If stmt is LET v = rhs, sets rhs and returns the slot of v;
+ * otherwise returns -1.
+ */
+
+static int getAssignedSlot(Statement *stmt, Expression *&rhs)
+{
+    if (stmt->getType() != LET)
+        return -1;
+    Expression *exp = ((SeqLET *)stmt)->getExp();
+    if (exp->getType() != COMPOUND || ((CompoundExp *)exp)->getOperator() != ASSIGN_OP)
+        return -1;
+    CompoundExp *assign = (CompoundExp *)exp;
+    if (assign->getLHS()->getType() != IDENTIFIER)
+        return -1;
+    rhs = assign->getRHS();
+    return ((IdentifierExp *)assign->getLHS())->getSlot();
+}
+
+static bool isProvenVariable(Expression *exp, int slot)
+{
+    if (exp->getType() != IDENTIFIER)
+        return false;
+    IdentifierExp *id = (IdentifierExp *)exp;
+    return id->getSlot() == slot && id->isProvenDefined();
+}
@@ -0,0 +1,81 @@
+/*
+ * File: idiom.h
+ * -------------
+ * This interface exports the idiom recognizer, which finds arithmetic
+ * patterns that BASIC has to spell out, such as a remainder or an
+ * absolute value, and has the executors run each as one operation.
+ */
+
+#ifndef _idiom_h
+#define _idiom_h
+
+#include "exp.h"
+#include "program.h"
+#include "statement.h"
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Class: IdiomRecognizer
+ * ----------------------
+ * This class matches the parsed program against these patterns:
+ *
+ *  q - q / p * p                      -- remainder, in any expression
+ *  IF v > 0 THEN L; LET v = 0 - v; L  -- absolute value
+ *  IF v > x THEN L; LET v = x; L      -- maximum (< gives the minimum)
+ *  H IF b = 0 THEN E; LET t = a - a / b * b; LET a = b; LET b = t;
+ *    GOTO H                           -- Euclid's GCD loop
+ *
+ * Every variable involved must be proven defined where it is read, and
+ * x, p and q must be constants or such variables, so that the fused
+ * operation prints nothing the statements would not print.  The
+ * remainder is marked with setRemainder and the others with setIdiom
+ * on the IF statement; the statements after the IF stay in place for
+ * any jump that reaches them some other way.
+ *
+ * The marks of an earlier RUN are cleared first.  The definedness
+ * analysis must have run on the program.
+ */
+
+class IdiomRecognizer
+{
+
+public:
+  /*
+ * Constructor: IdiomRecognizer
+ * Usage: IdiomRecognizer idioms(program, reservedCount);
+ * -----------------------
+ * Marks the idioms of the linked program.  reservedCount is the number
+ * of keyword slots, which are never assigned.
+ */
+
+  IdiomRecognizer(Program &program, int reservedCount);
+
+  /*
+ * Method: report
+ * Usage: idioms.report(cerr);
+ * -----------------------
+ * Writes one line to os for every idiom found, giving its line number
+ * and its name, in the order of the program.
+ */
+
+  void report(ostream &os);
+
+private:
+  void recognize(Expression *exp, int line);
+  void recognizeIF(ControlIF *ctrl);
+  bool isGCDLoop(ControlIF *ctrl, Idiom &idiom);
+
+  struct Rewrite
+  {
+    int line;
+    string name;
+  };
+
+  vector<Rewrite> rewrites;
+  int reservedCount;
+};
+
+#endif
@@ -0,0 +1,517 @@
+/*
+ * File: jit.cpp
+ * -------------
+ * This file implements the NativeCode class.
+ */
+
+#include "jit.h"
+#include "closedform.h"
+#include "evalstate.h"
+#include "regvm.h"
+#include "statement.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef HAS_NATIVE_JIT
+#include <sys/mman.h>
+#endif
+using namespace std;
+
+/*
+ * Implementation notes: runtime callbacks
+ * ---------------------------------------
+ * The generated code calls these functions for everything that does
+ * I/O, so the output goes through the same streams as the
+ * interpreter's.  They only take and return plain ints, which keeps
+ * the calls to the System V convention the compiler already uses.
+ */
+
+static void printValue(int value)
+{
+    cout << value << endl;
+}
+
+static int inputValue()
+{
+    return readInputValue();
+}
+
+static void reportSyntaxError()
+{
+    cout << "SYNTAX ERROR\n";
+}
+
+static void reportSyntaxErrorLine()
+{
+    cout << "SYNTAX ERROR" << endl;
+}
+
+static void reportNotDefined()
+{
+    cout << "VARIABLE NOT DEFINED\n";
+}
+
+static void reportDivideByZero()
+{
+    cout << "DIVIDE BY ZERO\n";
+}
+
+static void reportLineError()
+{
+    cout << "LINE NUMBER ERROR" << endl;
+}
+
+static void reportNotCompound()
+{
+    cout << "Compund expression expected" << endl;
+}
+
+/*
+ * Function: runClosedForm
+ * -----------------------
+ * Runs form on the variables of the frame, whose defined flags start
+ * at index definedBase.  This is the one callback that takes pointers.
+ */
+
+static void runClosedForm(ClosedForm *form, int *frame, int definedBase)
+{
+    vector<int> &slots = form->getSlots();
+    vector<int> values(slots.size());
+    for (int i = 0; i < slots.size(); i++)
+    {
+        if (!frame[definedBase + slots[i]])
+            return;
+        values[i] = frame[slots[i]];
+    }
+    if (!form->advance(values))
+        return;
+    for (int i = 0; i < slots.size(); i++)
+        frame[slots[i]] = values[i];
+}
+
+/*
+ * Implementation notes: x86-64 encoding
+ * -------------------------------------
+ * Only a handful of instruction forms are needed.  Frame accesses use
+ * [rbx + disp32], so operands are never kept in machine registers
+ * across instructions of the RegisterCode; eax and ecx are scratch.
+ */
+
+static const int EAX = 0;
+static const int ECX = 1;
+static const int EDX = 2;
+static const int EDI = 7;
+
+static const int MOV_LOAD = 0x8B;
+static const int MOV_STORE = 0x89;
+static const int ADD_LOAD = 0x03;
+static const int SUB_LOAD = 0x2B;
+static const int CMP_LOAD = 0x3B;
+
+static const int JMP_REL8 = 0xEB;
+static const int JNZ_REL8 = 0x75;
+static const int JZ_REL8 = 0x74;
+static const int JNS_REL8 = 0x79;
+static const int JGE_REL8 = 0x7D;
+static const int JLE_REL8 = 0x7E;
+
+NativeCode::NativeCode(RegisterCode &code) : code(code)
+{
+    memory = NULL;
+    memorySize = 0;
+    int registerCount = code.variableCount + code.temporaryCount + code.constants.size();
+    definedBase = registerCount;
+    frame.resize(registerCount + code.variableCount);
+    if (isAvailable())
+        compile();
+}
+
+NativeCode::~NativeCode()
+{
+#ifdef HAS_NATIVE_JIT
+    if (memory != NULL)
+        munmap(memory, memorySize);
+#endif
+}
+
+bool NativeCode::isAvailable()
+{
+#ifdef HAS_NATIVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Implementation notes: compile
+ * -----------------------------
+ * The generated function has the signature void (int *frame, void
+ * *entry).  Its prologue saves the callee-saved registers it uses,
+ * which also keeps the stack 16-byte aligned for the callbacks, and
+ * jumps to entry; the epilogue follows directly and is the target of
+ * every REG_HALT.
+ */
+
+void NativeCode::compile()
+{
+#ifdef HAS_NATIVE_JIT
+    emitByte(0x53);                 // push rbx
+    emitByte(0x41), emitByte(0x54); // push r12
+    emitByte(0x41), emitByte(0x55); // push r13
+    emitByte(0x48), emitByte(0x89), emitByte(0xFB); // mov rbx, rdi
+    emitByte(0x41), emitByte(0xBD), emitInt32(1);   // mov r13d, 1
+    emitByte(0xFF), emitByte(0xE6); // jmp rsi
+    int epilogue = buffer.size();
+    emitByte(0x41), emitByte(0x5D); // pop r13
+    emitByte(0x41), emitByte(0x5C); // pop r12
+    emitByte(0x5B);                 // pop rbx
+    emitByte(0xC3);                 // ret
+
+    for (int i = 0; i < code.code.size(); i++)
+    {
+        addresses.push_back(buffer.size());
+        if (code.code[i].op == REG_HALT)
+            emitJump(0xE9, -1 - epilogue);
+        else
+            compileInstruction(code.code[i]);
+    }
+    for (int i = 0; i < jumps.size(); i++)
+    {
+        int target = jumps[i].target < 0 ? -1 - jumps[i].target : addresses[jumps[i].target];
+        int rel = target - (jumps[i].at + 4);
+        memcpy(&buffer[jumps[i].at], &rel, 4);
+    }
+    jumps.clear();
+
+    memorySize = buffer.size();
+    void *pages = mmap(NULL, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED)
+        return;
+    memcpy(pages, &buffer[0], memorySize);
+    if (mprotect(pages, memorySize, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(pages, memorySize);
+        return;
+    }
+    memory = (unsigned char *)pages;
+#endif
+}
+
+void NativeCode::compileInstruction(RegisterInstruction &ins)
+{
+    switch (ins.op)
+    {
+    case REG_ADD:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(ADD_LOAD, EAX, ins.b);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        break;
+    case REG_SUB:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(SUB_LOAD, EAX, ins.b);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        break;
+    case REG_MUL:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitByte(0x0F);
+        emitFrameOp(0xAF, EAX, ins.b); // imul eax, [rbx + b]
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        break;
+    case REG_DIV:
+    {
+        emitFrameOp(MOV_LOAD, ECX, ins.b);
+        emitByte(0x85), emitByte(0xC9); // test ecx, ecx
+        int nonzero = emitShortJump(JNZ_REL8);
+        emitCall((void *)reportDivideByZero);
+        emitStoreImmediate(ins.dst, 0);
+        emitByte(0x45), emitByte(0x31), emitByte(0xED); // xor r13d, r13d
+        int done = emitShortJump(JMP_REL8);
+        patchShortJump(nonzero);
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitByte(0x99);                 // cdq
+        emitByte(0xF7), emitByte(0xF9); // idiv ecx
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        emitByte(0x41), emitByte(0xBD), emitInt32(1); // mov r13d, 1
+        patchShortJump(done);
+        break;
+    }
+    case REG_DIV_NONZERO:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitByte(0x99);               // cdq
+        emitFrameOp(0xF7, 7, ins.b); // idiv dword [rbx + b]
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        emitByte(0x41), emitByte(0xBD), emitInt32(1); // mov r13d, 1
+        break;
+    case REG_REM:
+    {
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(MOV_LOAD, ECX, ins.b);
+        emitByte(0x85), emitByte(0xC9); // test ecx, ecx
+        int nonzero = emitShortJump(JNZ_REL8);
+        emitCall((void *)reportDivideByZero);
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        int done = emitShortJump(JMP_REL8);
+        patchShortJump(nonzero);
+        emitByte(0x99);                 // cdq
+        emitByte(0xF7), emitByte(0xF9); // idiv ecx
+        emitFrameOp(MOV_STORE, EDX, ins.dst);
+        patchShortJump(done);
+        emitByte(0x41), emitByte(0xBD), emitInt32(1); // mov r13d, 1
+        break;
+    }
+    case REG_MOVE:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        break;
+    case REG_STORE:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        emitStoreImmediate(definedBase + ins.dst, 1);
+        break;
+    case REG_BAD_STORE:
+        emitCall((void *)reportSyntaxError);
+        break;
+    case REG_CHECK:
+    {
+        emitFrameOp(MOV_LOAD, EAX, definedBase + ins.dst);
+        emitByte(0x41), emitByte(0x89), emitByte(0xC5); // mov r13d, eax
+        emitByte(0x85), emitByte(0xC0);                 // test eax, eax
+        int defined = emitShortJump(JNZ_REL8);
+        emitCall((void *)reportNotDefined);
+        patchShortJump(defined);
+        break;
+    }
+    case REG_BAD_ASSIGN:
+    case REG_BAD_OP:
+        emitCall((void *)reportSyntaxError);
+        emitStoreImmediate(ins.dst, 0);
+        emitByte(0x45), emitByte(0x31), emitByte(0xED); // xor r13d, r13d
+        break;
+    case REG_PRINT:
+        emitFrameOp(MOV_LOAD, EDI, ins.a);
+        emitCall((void *)printValue);
+        break;
+    case REG_PRINT_FLAG:
+    {
+        emitByte(0x45), emitByte(0x85), emitByte(0xED); // test r13d, r13d
+        int skip = emitShortJump(JZ_REL8);
+        emitFrameOp(MOV_LOAD, EDI, ins.a);
+        emitCall((void *)printValue);
+        patchShortJump(skip);
+        break;
+    }
+    case REG_INPUT:
+        emitCall((void *)inputValue);
+        if (ins.dst < code.reservedCount)
+            emitCall((void *)reportSyntaxError);
+        else
+        {
+            emitFrameOp(MOV_STORE, EAX, ins.dst);
+            emitStoreImmediate(definedBase + ins.dst, 1);
+        }
+        break;
+    case REG_ABS:
+    {
+        emitFrameOp(MOV_LOAD, EAX, ins.dst);
+        emitByte(0x85), emitByte(0xC0); // test eax, eax
+        int positive = emitShortJump(JNS_REL8);
+        emitByte(0xF7), emitByte(0xD8); // neg eax
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        patchShortJump(positive);
+        break;
+    }
+    case REG_MAX:
+    case REG_MIN:
+    {
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(CMP_LOAD, EAX, ins.dst);
+        int keep = emitShortJump(ins.op == REG_MAX ? JLE_REL8 : JGE_REL8);
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        patchShortJump(keep);
+        break;
+    }
+    case REG_GCD:
+    {
+        emitFrameOp(MOV_LOAD, EAX, ins.dst);
+        emitFrameOp(MOV_LOAD, ECX, ins.a);
+        emitByte(0x85), emitByte(0xC9); // test ecx, ecx
+        int done = emitShortJump(JZ_REL8);
+        int loop = buffer.size();
+        emitByte(0x99);                 // cdq
+        emitByte(0xF7), emitByte(0xF9); // idiv ecx
+        emitByte(0x89), emitByte(0xC8); // mov eax, ecx
+        emitByte(0x89), emitByte(0xD1); // mov ecx, edx
+        emitByte(0x85), emitByte(0xC9); // test ecx, ecx
+        emitByte(JNZ_REL8);
+        emitByte(loop - (int)(buffer.size() + 1));
+        emitFrameOp(MOV_STORE, EAX, ins.dst);
+        emitFrameOp(MOV_STORE, ECX, ins.a);
+        emitFrameOp(MOV_STORE, ECX, ins.b);
+        emitStoreImmediate(definedBase + ins.b, 1);
+        patchShortJump(done);
+        break;
+    }
+    case REG_CLOSED_FORM:
+    {
+        long long form = (long long)code.closedForms[ins.dst];
+        unsigned char bytes[8];
+        memcpy(bytes, &form, 8);
+        emitByte(0x48), emitByte(0xBF); // mov rdi, form
+        buffer.insert(buffer.end(), bytes, bytes + 8);
+        emitByte(0x48), emitByte(0x89), emitByte(0xDE); // mov rsi, rbx
+        emitByte(0xBA), emitInt32(definedBase);          // mov edx, definedBase
+        emitCall((void *)runClosedForm);
+        break;
+    }
+    case REG_JUMP:
+        emitJump(0xE9, ins.dst);
+        break;
+    case REG_JUMP_GT:
+    case REG_JUMP_LT:
+    case REG_JUMP_EQ:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(CMP_LOAD, EAX, ins.b);
+        emitByte(0x0F);
+        if (ins.op == REG_JUMP_GT)
+            emitJump(0x8F, ins.dst);
+        else if (ins.op == REG_JUMP_LT)
+            emitJump(0x8C, ins.dst);
+        else
+            emitJump(0x84, ins.dst);
+        break;
+    case REG_LOOP_GT:
+    case REG_LOOP_LT:
+    case REG_LOOP_EQ:
+        emitFrameOp(MOV_LOAD, EAX, ins.a);
+        emitFrameOp(ADD_LOAD, EAX, ins.c);
+        emitFrameOp(MOV_STORE, EAX, ins.a);
+        emitFrameOp(CMP_LOAD, EAX, ins.b);
+        emitByte(0x0F);
+        if (ins.op == REG_LOOP_GT)
+            emitJump(0x8F, ins.dst);
+        else if (ins.op == REG_LOOP_LT)
+            emitJump(0x8C, ins.dst);
+        else
+            emitJump(0x84, ins.dst);
+        break;
+    case REG_BAD_CMP:
+        emitCall((void *)reportSyntaxErrorLine);
+        break;
+    case REG_LINE_ERROR:
+        emitCall((void *)reportLineError);
+        break;
+    case REG_NOT_COMPOUND:
+        emitCall((void *)reportNotCompound);
+        break;
+    }
+}
+
+void NativeCode::emitByte(int byte)
+{
+    buffer.push_back((unsigned char)byte);
+}
+
+void NativeCode::emitInt32(int value)
+{
+    unsigned char bytes[4];
+    memcpy(bytes, &value, 4);
+    buffer.insert(buffer.end(), bytes, bytes + 4);
+}
+
+/*
+ * Implementation notes: emitFrameOp
+ * ---------------------------------
+ * Emits op reg, [rbx + 4 * index], using the ModRM form with a 32-bit
+ * displacement (mod = 10, rm = rbx).
+ */
+
+void NativeCode::emitFrameOp(int op, int reg, int index)
+{
+    emitByte(op);
+    emitByte(0x80 | (reg << 3) | 3);
+    emitInt32(4 * index);
+}
+
+void NativeCode::emitStoreImmediate(int index, int value)
+{
+    emitFrameOp(0xC7, 0, index); // mov dword [rbx + 4 * index], value
+    emitInt32(value);
+}
+
+void NativeCode::emitCall(void *function)
+{
+    long long address = (long long)function;
+    emitByte(0x48), emitByte(0xB8); // mov rax, address
+    unsigned char bytes[8];
+    memcpy(bytes, &address, 8);
+    buffer.insert(buffer.end(), bytes, bytes + 8);
+    emitByte(0xFF), emitByte(0xD0); // call rax
+}
+
+int NativeCode::emitShortJump(int op)
+{
+    emitByte(op);
+    emitByte(0);
+    return buffer.size() - 1;
+}
+
+void NativeCode::patchShortJump(int at)
+{
+    buffer[at] = (unsigned char)(buffer.size() - (at + 1));
+}
+
+/*
+ * Implementation notes: emitJump
+ * ------------------------------
+ * Emits the last opcode byte of a jump with a 32-bit displacement,
+ * which is patched once the native address of the target is known.
+ * A negative target -1 - offset refers to a native offset directly.
+ */
+
+void NativeCode::emitJump(int op, int target)
+{
+    emitByte(op);
+    PendingJump jump;
+    jump.at = buffer.size();
+    jump.target = target;
+    jumps.push_back(jump);
+    emitInt32(0);
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The frame is loaded and stored back the same way as the registers
+ * of the RegisterMachine.
+ */
+
+void NativeCode::run(EvalState &state, int pc)
+{
+    if (memory == NULL)
+    {
+        RegisterMachine machine(code);
+        machine.run(state, pc);
+        return;
+    }
+    int variableCount = code.variableCount;
+    for (int i = 0; i < variableCount; i++)
+    {
+        frame[definedBase + i] = state.isDefined(i);
+        frame[i] = frame[definedBase + i] ? state.getValue(i) : 0;
+    }
+    int constantBase = variableCount + code.temporaryCount;
+    for (int i = 0; i < code.constants.size(); i++)
+        frame[constantBase + i] = code.constants[i];
+
+    typedef void (*Function)(int *frame, void *entry);
+    Function function = (Function)memory;
+    function(&frame[0], memory + addresses[pc]);
+
+    for (int i = 0; i < variableCount; i++)
+    {
+        if (frame[definedBase + i])
+            state.setValue(i, frame[i]);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * File: jit.h
+ * -----------
+ * This interface exports the NativeCode class, which translates the
+ * three-address code of the register machine into x86-64 machine code
+ * and runs it.
+ */
+
+#ifndef _jit_h
+#define _jit_h
+
+#include "evalstate.h"
+#include "regvm.h"
+#include <vector>
+using namespace std;
+
+#if defined(__x86_64__) && defined(__linux__)
+#define HAS_NATIVE_JIT 1
+#endif
+
+/*
+ * Class: NativeCode
+ * -----------------
+ * This class holds a program compiled to native code in executable
+ * pages obtained with mmap.  Every register of the RegisterCode, and
+ * the defined bit of every variable, lives in a fixed frame addressed
+ * through rbx, and the flag register of the interpreter is kept in
+ * r13.  PRINT, INPUT and the error messages call back into C++.
+ *
+ * On other platforms isAvailable returns false and RUN falls back to
+ * the register machine.
+ */
+
+class NativeCode
+{
+
+public:
+  /*
+ * Constructor: NativeCode
+ * Usage: NativeCode native(code);
+ * -----------------------
+ * Translates the compiled program into machine code.
+ */
+
+  NativeCode(RegisterCode &code);
+
+  /*
+ * Destructor: ~NativeCode
+ * Usage: usually implicit
+ * -----------------------
+ * Releases the executable pages.
+ */
+
+  ~NativeCode();
+
+  /*
+ * Method: isAvailable
+ * Usage: if (NativeCode::isAvailable()) . . .
+ * -----------------------
+ * Returns true if the JIT supports this platform.
+ */
+
+  static bool isAvailable();
+
+  /*
+ * Method: run
+ * Usage: native.run(state, pc);
+ * -----------------------
+ * Executes the program from the instruction at pc of the RegisterCode
+ * until it halts.
+ */
+
+  void run(EvalState &state, int pc);
+
+private:
+  void compile();
+  void compileInstruction(RegisterInstruction &ins);
+  void emitByte(int byte);
+  void emitInt32(int value);
+  void emitFrameOp(int op, int reg, int index);
+  void emitStoreImmediate(int index, int value);
+  void emitCall(void *function);
+  int emitShortJump(int op);
+  void patchShortJump(int at);
+  void emitJump(int op, int target);
+
+  struct PendingJump
+  {
+    int at;
+    int target;
+  };
+
+  RegisterCode &code;
+  vector<unsigned char> buffer;
+  vector<int> addresses;
+  vector<PendingJump> jumps;
+  vector<int> frame;
+  int definedBase;
+  unsigned char *memory;
+  int memorySize;
+};
+
+#endif
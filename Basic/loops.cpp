@@ -0,0 +1,643 @@
+/*
+ * File: loops.cpp
+ * ---------------
+ * This file implements loop-invariant code motion and the recognition
+ * of induction variables.
+ */
+
+#include "loops.h"
+#include "cfg.h"
+#include "closedform.h"
+#include "exp.h"
+#include "statement.h"
+#include "symtab.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+static vector<Expression *> getExpressions(Statement *stmt);
+static void unmark(Expression *exp);
+static void collectAssigned(Expression *exp, set<int> &assigned);
+static bool isInvariant(Expression *exp, const set<int> &assigned);
+static void countAssignments(Expression *exp, map<int, int> &count);
+static bool isIncrement(Statement *stmt, int &slot, int &step);
+static bool isDefinedOnEntry(BasicBlock *header, int slot);
+static int findFirstUse(Expression *exp, int slot);
+
+/*
+ * Implementation notes: LoopInvariants
+ * ------------------------------------
+ * Dominators are computed over the blocks reachable from the entry by
+ * the usual iteration to a fixpoint.  An edge whose target dominates
+ * its source is a back edge, and the loop it closes is the target
+ * plus every block that reaches the source without passing the
+ * target; loops sharing a header are merged.  Natural loops are either
+ * nested or disjoint, so handling the larger loops first hoists every
+ * expression to the outermost loop it is invariant in, and an inner
+ * preheader may use what an outer one computed.
+ *
+ * Strength reduction runs after hoisting and goes the other way, from
+ * the smaller loops out, so a product is reduced in the innermost loop
+ * that increments its variable.  A product keeps its value between
+ * statements: the preheader computes it, any statement falling into
+ * the header computes it again, and the update directly follows the
+ * increment.  All arithmetic wraps, so i * k + c * k is (i + c) * k
+ * even across an overflow.
+ */
+
+LoopInvariants::LoopInvariants(ControlFlowGraph &cfg, SymbolTable &symbols)
+{
+    hoistedCount = 0;
+    reducedCount = 0;
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    int n = blocks.size();
+    for (int i = 0; i < n; i++)
+    {
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+        {
+            vector<Expression *> exps = getExpressions(stmts[j]);
+            for (int k = 0; k < exps.size(); k++)
+                unmark(exps[k]);
+        }
+    }
+    BasicBlock *entry = cfg.getEntry();
+    if (entry == NULL)
+        return;
+
+    vector<bool> reachable(n, false);
+    vector<BasicBlock *> work(1, entry);
+    reachable[entry->getId()] = true;
+    while (!work.empty())
+    {
+        BasicBlock *block = work.back();
+        work.pop_back();
+        vector<BasicBlock *> &succs = block->getSuccessors();
+        for (int i = 0; i < succs.size(); i++)
+        {
+            if (!reachable[succs[i]->getId()])
+            {
+                reachable[succs[i]->getId()] = true;
+                work.push_back(succs[i]);
+            }
+        }
+    }
+
+    vector<vector<bool> > dom(n, vector<bool>(n, true));
+    dom[entry->getId()] = vector<bool>(n, false);
+    dom[entry->getId()][entry->getId()] = true;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < n; i++)
+        {
+            if (!reachable[i] || blocks[i] == entry)
+                continue;
+            vector<bool> meet(n, true);
+            vector<BasicBlock *> &preds = blocks[i]->getPredecessors();
+            for (int j = 0; j < preds.size(); j++)
+            {
+                if (!reachable[preds[j]->getId()])
+                    continue;
+                vector<bool> &predDom = dom[preds[j]->getId()];
+                for (int k = 0; k < n; k++)
+                    meet[k] = meet[k] && predDom[k];
+            }
+            meet[i] = true;
+            if (meet != dom[i])
+            {
+                dom[i] = meet;
+                changed = true;
+            }
+        }
+    }
+
+    map<BasicBlock *, int> loopOfHeader;
+    for (int i = 0; i < n; i++)
+    {
+        if (!reachable[i])
+            continue;
+        vector<BasicBlock *> &succs = blocks[i]->getSuccessors();
+        for (int j = 0; j < succs.size(); j++)
+        {
+            BasicBlock *header = succs[j];
+            if (!dom[i][header->getId()])
+                continue;
+            if (loopOfHeader.count(header) == 0)
+            {
+                loopOfHeader[header] = loops.size();
+                loops.push_back(Loop());
+                loops.back().header = header;
+                loops.back().blocks.insert(header);
+            }
+            Loop &loop = loops[loopOfHeader[header]];
+            work.assign(1, blocks[i]);
+            while (!work.empty())
+            {
+                BasicBlock *block = work.back();
+                work.pop_back();
+                if (loop.blocks.count(block) != 0 || !reachable[block->getId()])
+                    continue;
+                loop.blocks.insert(block);
+                vector<BasicBlock *> &preds = block->getPredecessors();
+                work.insert(work.end(), preds.begin(), preds.end());
+            }
+        }
+    }
+
+    multimap<int, int> bySize;
+    for (int i = 0; i < loops.size(); i++)
+    {
+        Loop &loop = loops[i];
+        for (int j = 0; j < n; j++)
+        {
+            if (loop.blocks.count(blocks[j]) == 0)
+                continue;
+            vector<Statement *> &stmts = blocks[j]->getStatements();
+            for (int k = 0; k < stmts.size(); k++)
+            {
+                loop.statements.insert(stmts[k]);
+                if (stmts[k]->getType() == INPUT)
+                    loop.assigned.insert(((SeqINPUT *)stmts[k])->getSlot());
+                vector<Expression *> exps = getExpressions(stmts[k]);
+                for (int e = 0; e < exps.size(); e++)
+                    collectAssigned(exps[e], loop.assigned);
+            }
+        }
+        loop.closedForm.recognize(loop.header->getFirst(), loop.statements, symbols.getReservedCount());
+        bySize.insert(make_pair(-(int)loop.blocks.size(), i));
+    }
+
+    for (multimap<int, int>::iterator it = bySize.begin(); it != bySize.end(); it++)
+    {
+        Loop &loop = loops[it->second];
+        for (int j = 0; j < n; j++)
+        {
+            if (loop.blocks.count(blocks[j]) == 0)
+                continue;
+            vector<Statement *> &stmts = blocks[j]->getStatements();
+            for (int k = 0; k < stmts.size(); k++)
+            {
+                vector<Expression *> exps = getExpressions(stmts[k]);
+                for (int e = 0; e < exps.size(); e++)
+                    hoist(exps[e], loop, symbols);
+            }
+        }
+    }
+
+    for (multimap<int, int>::reverse_iterator it = bySize.rbegin(); it != bySize.rend(); it++)
+    {
+        Loop &loop = loops[it->second];
+        findInductions(loop);
+        if (loop.inductions.empty())
+            continue;
+        for (int j = 0; j < n; j++)
+        {
+            if (loop.blocks.count(blocks[j]) == 0)
+                continue;
+            vector<Statement *> &stmts = blocks[j]->getStatements();
+            for (int k = 0; k < stmts.size(); k++)
+            {
+                vector<Expression *> exps = getExpressions(stmts[k]);
+                for (int e = 0; e < exps.size(); e++)
+                    reduce(exps[e], loop, symbols);
+            }
+        }
+        map<int, Statement *>::iterator ind;
+        for (ind = loop.inductions.begin(); ind != loop.inductions.end(); ind++)
+            findCountedLoop(loop, ind->second);
+    }
+
+    for (int i = 0; i < loops.size(); i++)
+    {
+        Loop &loop = loops[i];
+        bool closed = loop.closedForm.isRecognized();
+        if (loop.hoisted.empty() && loop.reductions.empty() && !closed)
+            continue;
+        loopOf[loop.header->getFirst()] = i;
+        if (loop.hoisted.empty() && !closed)
+            continue;
+        BasicBlock *pre = cfg.insertPreheader(loop.header, loop.blocks);
+        pre->getHoisted() = loop.hoisted;
+        if (closed)
+            pre->setClosedForm(&loop.closedForm);
+    }
+}
+
+vector<CompoundExp *> &LoopInvariants::getPreheader(Statement *stmt)
+{
+    map<Statement *, int>::iterator it = loopOf.find(stmt);
+    if (it == loopOf.end())
+        return none;
+    return loops[it->second].hoisted;
+}
+
+bool LoopInvariants::isBackEdge(Statement *from, Statement *target)
+{
+    map<Statement *, int>::iterator it = loopOf.find(target);
+    return it != loopOf.end() && loops[it->second].statements.count(from) != 0;
+}
+
+int LoopInvariants::getHoistedCount()
+{
+    return hoistedCount;
+}
+
+vector<LoopInvariants::Reduction> &LoopInvariants::getReductions(Statement *stmt)
+{
+    map<Statement *, int>::iterator it = loopOf.find(stmt);
+    if (it == loopOf.end())
+        return noReductions;
+    return loops[it->second].reductions;
+}
+
+vector<LoopInvariants::Reduction> &LoopInvariants::getUpdates(Statement *stmt)
+{
+    map<Statement *, vector<Reduction> >::iterator it = updates.find(stmt);
+    if (it == updates.end())
+        return noReductions;
+    return it->second;
+}
+
+int LoopInvariants::getReducedSlot(CompoundExp *cexp)
+{
+    map<CompoundExp *, int>::iterator it = reduced.find(cexp);
+    if (it == reduced.end())
+        return -1;
+    return it->second;
+}
+
+bool LoopInvariants::isCountedLoop(Statement *stmt)
+{
+    return counted.count(stmt) != 0;
+}
+
+int LoopInvariants::getStep(Statement *stmt)
+{
+    return steps[stmt];
+}
+
+int LoopInvariants::getReducedCount()
+{
+    return reducedCount;
+}
+
+ClosedForm *LoopInvariants::getClosedForm(Statement *stmt)
+{
+    map<Statement *, int>::iterator it = loopOf.find(stmt);
+    if (it == loopOf.end() || !loops[it->second].closedForm.isRecognized())
+        return NULL;
+    return &loops[it->second].closedForm;
+}
+
+/*
+ * Method: hoist
+ * -------------
+ * Hoists the largest invariant subtrees of exp out of loop, giving
+ * each one a fresh hidden variable.  The left side of an assignment
+ * is a variable, not a value, so it is never looked at.
+ */
+
+void LoopInvariants::hoist(Expression *exp, Loop &loop, SymbolTable &symbols)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getHoistedSlot() >= 0)
+        return;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        hoist(cexp->getRHS(), loop, symbols);
+        return;
+    }
+    if (isInvariant(cexp, loop.assigned))
+    {
+        ostringstream name;
+        name << "#" << hoistedCount++;
+        cexp->setHoistedSlot(symbols.intern(name.str()));
+        loop.hoisted.push_back(cexp);
+        return;
+    }
+    hoist(cexp->getLHS(), loop, symbols);
+    hoist(cexp->getRHS(), loop, symbols);
+}
+
+/*
+ * Method: findInductions
+ * ----------------------
+ * Records the induction variables of loop.  The increment must be the
+ * only assignment to its variable anywhere in the loop, and the
+ * variable must be defined whenever the loop is entered, which is the
+ * case if the header block reads it, proven, before assigning it.
+ */
+
+void LoopInvariants::findInductions(Loop &loop)
+{
+    map<int, int> count;
+    map<int, Statement *> increments;
+    for (set<Statement *>::iterator it = loop.statements.begin(); it != loop.statements.end(); it++)
+    {
+        Statement *stmt = *it;
+        if (stmt->getType() == INPUT)
+            count[((SeqINPUT *)stmt)->getSlot()] += 2;
+        vector<Expression *> exps = getExpressions(stmt);
+        for (int e = 0; e < exps.size(); e++)
+            countAssignments(exps[e], count);
+        int slot, step;
+        if (isIncrement(stmt, slot, step))
+            increments[slot] = stmt;
+    }
+    map<int, Statement *>::iterator it;
+    for (it = increments.begin(); it != increments.end(); it++)
+    {
+        int slot, step;
+        if (count[it->first] == 1 && isDefinedOnEntry(loop.header, it->first))
+        {
+            isIncrement(it->second, slot, step);
+            loop.inductions[it->first] = it->second;
+            steps[it->second] = step;
+        }
+    }
+}
+
+/*
+ * Method: reduce
+ * --------------
+ * Strength reduces the products of an induction variable of loop and
+ * a constant within exp.  Hoisted expressions are already computed
+ * once per loop and are left alone.
+ */
+
+void LoopInvariants::reduce(Expression *exp, Loop &loop, SymbolTable &symbols)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getHoistedSlot() >= 0 || reduced.count(cexp) != 0)
+        return;
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        reduce(cexp->getRHS(), loop, symbols);
+        return;
+    }
+    if (cexp->getOperator() == MUL_OP)
+    {
+        Expression *var = cexp->getLHS();
+        Expression *factor = cexp->getRHS();
+        if (var->getType() == CONSTANT)
+            swap(var, factor);
+        if (var->getType() == IDENTIFIER && factor->getType() == CONSTANT && ((IdentifierExp *)var)->isProvenDefined())
+        {
+            int slot = ((IdentifierExp *)var)->getSlot();
+            map<int, Statement *>::iterator it = loop.inductions.find(slot);
+            if (it != loop.inductions.end())
+            {
+                int step = steps[it->second];
+                ostringstream name;
+                name << "#*" << reducedCount++;
+                Reduction reduction;
+                reduction.exp = cexp;
+                reduction.slot = symbols.intern(name.str());
+                reduction.step = (int)((unsigned)step * (unsigned)((ConstantExp *)factor)->getValue());
+                reduced[cexp] = reduction.slot;
+                loop.reductions.push_back(reduction);
+                updates[it->second].push_back(reduction);
+                return;
+            }
+        }
+    }
+    reduce(cexp->getLHS(), loop, symbols);
+    reduce(cexp->getRHS(), loop, symbols);
+}
+
+/*
+ * Method: findCountedLoop
+ * -----------------------
+ * Records increment as a counted loop if the block holding it ends
+ * with a test of its variable that jumps back to the loop header.
+ */
+
+void LoopInvariants::findCountedLoop(Loop &loop, Statement *increment)
+{
+    for (set<BasicBlock *>::iterator it = loop.blocks.begin(); it != loop.blocks.end(); it++)
+    {
+        vector<Statement *> &stmts = (*it)->getStatements();
+        int size = stmts.size();
+        if (size < 2 || stmts[size - 2] != increment)
+            continue;
+        if (stmts[size - 1]->getType() != IF)
+            return;
+        ControlIF *ctrl = (ControlIF *)stmts[size - 1];
+        if (ctrl->getTarget() != loop.header->getFirst())
+            return;
+        char cmp = ctrl->getCmp();
+        if (cmp != '<' && cmp != '>' && cmp != '=')
+            return;
+        CompoundExp *exp = (CompoundExp *)((SeqLET *)increment)->getExp();
+        int slot = ((IdentifierExp *)exp->getLHS())->getSlot();
+        Expression *lhs = ctrl->getLHS();
+        if (lhs->getType() != IDENTIFIER || ((IdentifierExp *)lhs)->getSlot() != slot)
+            return;
+        Expression *rhs = ctrl->getRHS();
+        if (rhs->getType() == IDENTIFIER && !((IdentifierExp *)rhs)->isProvenDefined())
+            return;
+        if (rhs->getType() == COMPOUND && ((CompoundExp *)rhs)->getHoistedSlot() < 0)
+            return;
+        counted.insert(increment);
+        return;
+    }
+}
+
+/*
+ * Function: getExpressions
+ * ------------------------
+ * Returns the expression trees of stmt in the order they run.
+ */
+
+static vector<Expression *> getExpressions(Statement *stmt)
+{
+    vector<Expression *> exps;
+    if (stmt->getType() == LET)
+        exps.push_back(((SeqLET *)stmt)->getExp());
+    else if (stmt->getType() == PRINT)
+        exps.push_back(((SeqPRINT *)stmt)->getExp());
+    else if (stmt->getType() == IF)
+    {
+        exps.push_back(((ControlIF *)stmt)->getLHS());
+        exps.push_back(((ControlIF *)stmt)->getRHS());
+    }
+    return exps;
+}
+
+static void unmark(Expression *exp)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    cexp->setHoistedSlot(-1);
+    unmark(cexp->getLHS());
+    unmark(cexp->getRHS());
+}
+
+static void collectAssigned(Expression *exp, set<int> &assigned)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP && cexp->getLHS()->getType() == IDENTIFIER)
+        assigned.insert(((IdentifierExp *)cexp->getLHS())->getSlot());
+    collectAssigned(cexp->getLHS(), assigned);
+    collectAssigned(cexp->getRHS(), assigned);
+}
+
+/*
+ * Function: isInvariant
+ * ---------------------
+ * Returns true if exp gives the same value on every iteration of a
+ * loop that assigns the slots in assigned, and evaluating it can
+ * neither print nor trap.  An expression already hoisted out of an
+ * enclosing loop qualifies as a whole.
+ */
+
+static bool isInvariant(Expression *exp, const set<int> &assigned)
+{
+    if (exp->getType() == CONSTANT)
+        return true;
+    if (exp->getType() == IDENTIFIER)
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        return id->isProvenDefined() && assigned.count(id->getSlot()) == 0;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getHoistedSlot() >= 0)
+        return true;
+    switch (cexp->getOperator())
+    {
+    case ADD_OP:
+    case SUB_OP:
+    case MUL_OP:
+        return isInvariant(cexp->getLHS(), assigned) && isInvariant(cexp->getRHS(), assigned);
+    case DIV_OP:
+    {
+        Expression *rhs = cexp->getRHS();
+        if (rhs->getType() != CONSTANT)
+            return false;
+        int divisor = ((ConstantExp *)rhs)->getValue();
+        return divisor != 0 && divisor != -1 && isInvariant(cexp->getLHS(), assigned);
+    }
+    default:
+        return false;
+    }
+}
+
+static void countAssignments(Expression *exp, map<int, int> &count)
+{
+    if (exp->getType() != COMPOUND)
+        return;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP && cexp->getLHS()->getType() == IDENTIFIER)
+        count[((IdentifierExp *)cexp->getLHS())->getSlot()]++;
+    countAssignments(cexp->getLHS(), count);
+    countAssignments(cexp->getRHS(), count);
+}
+
+/*
+ * Function: isIncrement
+ * ---------------------
+ * Returns true if stmt is LET i = i + c, LET i = c + i or LET i = i - c
+ * for a constant c and a proven read of i, setting slot to i and step
+ * to the amount i advances by.
+ */
+
+static bool isIncrement(Statement *stmt, int &slot, int &step)
+{
+    if (stmt->getType() != LET)
+        return false;
+    Expression *exp = ((SeqLET *)stmt)->getExp();
+    if (exp->getType() != COMPOUND || ((CompoundExp *)exp)->getOperator() != ASSIGN_OP)
+        return false;
+    Expression *lhs = ((CompoundExp *)exp)->getLHS();
+    Expression *rhs = ((CompoundExp *)exp)->getRHS();
+    if (lhs->getType() != IDENTIFIER || rhs->getType() != COMPOUND)
+        return false;
+    slot = ((IdentifierExp *)lhs)->getSlot();
+    CompoundExp *sum = (CompoundExp *)rhs;
+    Expression *var = sum->getLHS();
+    Expression *amount = sum->getRHS();
+    if (sum->getOperator() == ADD_OP && var->getType() == CONSTANT)
+        swap(var, amount);
+    else if (sum->getOperator() != SUB_OP && sum->getOperator() != ADD_OP)
+        return false;
+    if (var->getType() != IDENTIFIER || amount->getType() != CONSTANT)
+        return false;
+    IdentifierExp *id = (IdentifierExp *)var;
+    if (id->getSlot() != slot || !id->isProvenDefined())
+        return false;
+    step = ((ConstantExp *)amount)->getValue();
+    if (sum->getOperator() == SUB_OP)
+        step = (int)(0u - (unsigned)step);
+    return true;
+}
+
+/*
+ * Function: isDefinedOnEntry
+ * --------------------------
+ * Returns true if the header block reads the variable in slot, proven
+ * defined, before anything in the block assigns it.
+ */
+
+static bool isDefinedOnEntry(BasicBlock *header, int slot)
+{
+    vector<Statement *> &stmts = header->getStatements();
+    for (int i = 0; i < stmts.size(); i++)
+    {
+        vector<Expression *> exps = getExpressions(stmts[i]);
+        for (int e = 0; e < exps.size(); e++)
+        {
+            int use = findFirstUse(exps[e], slot);
+            if (use != 0)
+                return use > 0;
+        }
+        if (stmts[i]->getType() == INPUT && ((SeqINPUT *)stmts[i])->getSlot() == slot)
+            return false;
+    }
+    return false;
+}
+
+/*
+ * Function: findFirstUse
+ * ----------------------
+ * Looks for the first access to the variable in slot when exp is
+ * evaluated, returning 1 for a proven read, -1 for any other read or
+ * an assignment, and 0 if exp does not touch the variable.
+ */
+
+static int findFirstUse(Expression *exp, int slot)
+{
+    if (exp->getType() == CONSTANT)
+        return 0;
+    if (exp->getType() == IDENTIFIER)
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        if (id->getSlot() != slot)
+            return 0;
+        return id->isProvenDefined() ? 1 : -1;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP && cexp->getLHS()->getType() == IDENTIFIER)
+    {
+        int use = findFirstUse(cexp->getRHS(), slot);
+        if (use != 0)
+            return use;
+        return ((IdentifierExp *)cexp->getLHS())->getSlot() == slot ? -1 : 0;
+    }
+    int use = findFirstUse(cexp->getLHS(), slot);
+    if (use != 0)
+        return use;
+    return findFirstUse(cexp->getRHS(), slot);
+}
@@ -0,0 +1,220 @@
+/*
+ * File: loops.h
+ * -------------
+ * This interface exports loop-invariant code motion, which finds the
+ * loops of a program and moves the computations that give the same
+ * value on every iteration in front of them, and the recognition of
+ * induction variables and counted loops within them.
+ */
+
+#ifndef _loops_h
+#define _loops_h
+
+#include "cfg.h"
+#include "closedform.h"
+#include "exp.h"
+#include "statement.h"
+#include "symtab.h"
+#include <map>
+#include <set>
+#include <vector>
+using namespace std;
+
+/*
+ * Class: LoopInvariants
+ * ---------------------
+ * This class finds the natural loops of a control-flow graph, that is
+ * the back edges to a block that dominates their source, and hoists
+ * the invariant subexpressions of each loop into a preheader.
+ *
+ * An expression is hoisted only if evaluating it can neither print
+ * nor fail: its variables must be proven defined and never assigned
+ * in the loop, and it may divide only by a constant other than 0 and
+ * -1.  Evaluating such an expression early, or more than once, is
+ * invisible, so output and diagnostics keep their order.
+ *
+ * Each hoisted CompoundExp is marked with setHoistedSlot and its value
+ * lives in a hidden variable whose name cannot be written in BASIC.
+ * The tree walker runs the preheader blocks inserted into the graph;
+ * the compilers emit the preheader code in front of the header line
+ * and point the back edges past it.
+ *
+ * A variable whose only assignment in a loop is a statement LET i =
+ * i + c, for a constant c, is an induction variable of the loop.  A
+ * product of an induction variable and a constant is strength reduced:
+ * it lives in a hidden variable that the preheader sets and that is
+ * advanced by a constant right after each increment.  An increment
+ * followed by the back edge IF i < n THEN header is a counted loop.
+ * Both are used by the register compiler only; the tree walker and
+ * the stack compiler evaluate such expressions as written.
+ *
+ * A loop that only accumulates, as described in closedform.h, gets a
+ * ClosedForm, which every executor runs first thing in the preheader,
+ * before the hoisted expressions and the products are computed.
+ */
+
+class LoopInvariants
+{
+
+public:
+  /*
+ * Constructor: LoopInvariants
+ * Usage: LoopInvariants loops(cfg, symbols);
+ * -----------------------
+ * Finds the loops of cfg, marks the hoisted expressions, unmarks all
+ * others, and inserts a preheader into cfg for every loop that has
+ * hoisted expressions or a closed form.  The hidden variables are
+ * interned in symbols.  The definedness analysis and the idiom
+ * recognizer must have run on cfg.
+ */
+
+  LoopInvariants(ControlFlowGraph &cfg, SymbolTable &symbols);
+
+  /*
+ * Method: getPreheader
+ * Usage: vector<CompoundExp *> &hoisted = loops.getPreheader(stmt);
+ * -----------------------
+ * Returns the expressions to evaluate, in order, before the statement
+ * stmt when the loop it heads is entered.  The list is empty if stmt
+ * does not head a loop.
+ */
+
+  vector<CompoundExp *> &getPreheader(Statement *stmt);
+
+  /*
+ * Method: isBackEdge
+ * Usage: if (loops.isBackEdge(from, target)) . . .
+ * -----------------------
+ * Returns true if target heads a loop that contains from, so that a
+ * jump from from to target may skip the preheader.
+ */
+
+  bool isBackEdge(Statement *from, Statement *target);
+
+  /*
+ * Method: getHoistedCount
+ * Usage: int count = loops.getHoistedCount();
+ * -----------------------
+ * Returns the number of expressions hoisted out of all loops.
+ */
+
+  int getHoistedCount();
+
+  /*
+ * Type: Reduction
+ * ---------------
+ * A strength-reduced product exp, kept in the hidden variable slot,
+ * which advances by step whenever its induction variable does.
+ */
+
+  struct Reduction
+  {
+    CompoundExp *exp;
+    int slot;
+    int step;
+  };
+
+  /*
+ * Method: getReductions
+ * Usage: vector<Reduction> &products = loops.getReductions(stmt);
+ * -----------------------
+ * Returns the products to compute, in order, before the statement stmt
+ * when the loop it heads is entered.  The list is empty if stmt does
+ * not head a loop.
+ */
+
+  vector<Reduction> &getReductions(Statement *stmt);
+
+  /*
+ * Method: getUpdates
+ * Usage: vector<Reduction> &products = loops.getUpdates(stmt);
+ * -----------------------
+ * Returns the products to advance after the statement stmt, which is
+ * empty unless stmt increments an induction variable.
+ */
+
+  vector<Reduction> &getUpdates(Statement *stmt);
+
+  /*
+ * Method: getReducedSlot
+ * Usage: int slot = loops.getReducedSlot(cexp);
+ * -----------------------
+ * Returns the hidden variable holding the value of cexp, or -1 if
+ * cexp is not strength reduced.
+ */
+
+  int getReducedSlot(CompoundExp *cexp);
+
+  /*
+ * Method: isCountedLoop
+ * Usage: if (loops.isCountedLoop(stmt)) . . .
+ * -----------------------
+ * Returns true if stmt is an increment LET i = i + c whose next
+ * statement is a test IF i < n THEN header, or the same with > or =,
+ * that closes its loop, where n is a constant, a proven variable or a
+ * hoisted expression.  The two statements are in the same block, so
+ * nothing jumps to the test.
+ */
+
+  bool isCountedLoop(Statement *stmt);
+
+  /*
+ * Method: getStep
+ * Usage: int step = loops.getStep(stmt);
+ * -----------------------
+ * Returns the amount by which the increment stmt of an induction
+ * variable advances it.
+ */
+
+  int getStep(Statement *stmt);
+
+  /*
+ * Method: getReducedCount
+ * Usage: int count = loops.getReducedCount();
+ * -----------------------
+ * Returns the number of products strength reduced in all loops.
+ */
+
+  int getReducedCount();
+
+  /*
+ * Method: getClosedForm
+ * Usage: ClosedForm *form = loops.getClosedForm(stmt);
+ * -----------------------
+ * Returns the closed form to run before the statement stmt when the
+ * loop it heads is entered, or NULL if there is none.
+ */
+
+  ClosedForm *getClosedForm(Statement *stmt);
+
+private:
+  struct Loop
+  {
+    BasicBlock *header;
+    set<BasicBlock *> blocks;
+    set<Statement *> statements;
+    set<int> assigned;
+    vector<CompoundExp *> hoisted;
+    map<int, Statement *> inductions;
+    vector<Reduction> reductions;
+    ClosedForm closedForm;
+  };
+
+  void hoist(Expression *exp, Loop &loop, SymbolTable &symbols);
+  void findInductions(Loop &loop);
+  void reduce(Expression *exp, Loop &loop, SymbolTable &symbols);
+  void findCountedLoop(Loop &loop, Statement *increment);
+
+  vector<Loop> loops;
+  map<Statement *, int> loopOf;
+  map<Statement *, vector<Reduction> > updates;
+  map<CompoundExp *, int> reduced;
+  set<Statement *> counted;
+  map<Statement *, int> steps;
+  vector<CompoundExp *> none;
+  vector<Reduction> noReductions;
+  int hoistedCount;
+  int reducedCount;
+};
+
+#endif
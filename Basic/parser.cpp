@@ -18,9 +18,9 @@ using namespace std;
  * This code just reads an expression and then checks for extra tokens.
  */
 
-Expression *parseExp(TokenScanner &scanner)
+Expression *parseExp(TokenScanner &scanner, SymbolTable &symbols, Arena &arena)
 {
-    Expression *exp = readE(scanner);
+    Expression *exp = readE(scanner, symbols, arena);
     if (scanner.hasMoreTokens())
     {
         cout << "SYNTAX ERROR\n";
@@ -31,7 +31,7 @@ Expression *parseExp(TokenScanner &scanner)
 
 /*
  * Implementation notes: readE
- * Usage: exp = readE(scanner, prec);
+ * Usage: exp = readE(scanner, symbols, arena, prec);
  * ----------------------------------
  * This version of readE uses precedence to resolve the ambiguity in
  * the grammar.  At each recursive level, the parser reads operators and
@@ -40,9 +40,9 @@ Expression *parseExp(TokenScanner &scanner)
  * readE calls itself recursively to read in that subexpression as a unit.
  */
 
-Expression *readE(TokenScanner &scanner, int prec) //0 entire; 1 divided by =; 2 by + or -; 3 by * or /
+Expression *readE(TokenScanner &scanner, SymbolTable &symbols, Arena &arena, int prec) //0 entire; 1 divided by =; 2 by + or -; 3 by * or /
 {
-    Expression *exp = readT(scanner);
+    Expression *exp = readT(scanner, symbols, arena);
     string token;
     while (true)
     {
@@ -50,8 +50,8 @@ Expression *readE(TokenScanner &scanner, int prec) //0 entire; 1 divided by =; 2
         int newPrec = precedence(token);
         if (newPrec <= prec)
             break;
-        Expression *rhs = readE(scanner, newPrec);
-        exp = new CompoundExp(token, exp, rhs);
+        Expression *rhs = readE(scanner, symbols, arena, newPrec);
+        exp = new (arena) CompoundExp(token, exp, rhs);
     }
     scanner.saveToken(token);
     return exp;
@@ -61,20 +61,21 @@ Expression *readE(TokenScanner &scanner, int prec) //0 entire; 1 divided by =; 2
  * Implementation notes: readT
  * ---------------------------
  * This function scans a term, which is either an integer, an identifier,
- * or a parenthesized subexpression.
+ * or a parenthesized subexpression.  Identifiers are resolved to their
+ * slot here, once, instead of on every evaluation.
  */
 
-Expression *readT(TokenScanner &scanner)
+Expression *readT(TokenScanner &scanner, SymbolTable &symbols, Arena &arena)
 {
     string token = scanner.nextToken();
     TokenType type = scanner.getTokenType(token);
     if (type == WORD)
-        return new IdentifierExp(token);
+        return new (arena) IdentifierExp(symbols.intern(token));
     if (type == NUMBER)
-        return new ConstantExp(stringToInteger(token));
+        return new (arena) ConstantExp(stringToInteger(token));
     if (token != "(")
         cout << "SYNTAX ERROR\n";
-    Expression *exp = readE(scanner);
+    Expression *exp = readE(scanner, symbols, arena);
     if (scanner.nextToken() != ")")
     {
         cout << "SYNTAX ERROR\n";
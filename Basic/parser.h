@@ -7,43 +7,47 @@
 #ifndef _parser_h
 #define _parser_h
 
+#include "arena.h"
 #include "exp.h"
+#include "symtab.h"
 #include <string>
 
 #include "../StanfordCPPLib/tokenscanner.h"
 
 /*
  * Function: parseExp
- * Usage: Expression *exp = parseExp(scanner);
- * -------------------------------------------
+ * Usage: Expression *exp = parseExp(scanner, symbols, arena);
+ * -----------------------------------------------------------
  * Parses an expression by reading tokens from the scanner, which must
  * be provided by the client.  The scanner should be set to ignore
- * whitespace and to scan numbers.
+ * whitespace and to scan numbers.  Every identifier is interned into
+ * the symbol table, so the resulting tree refers to variables by slot.
+ * The nodes of the tree are allocated in arena.
  */
 
-Expression *parseExp(TokenScanner & scanner);
+Expression *parseExp(TokenScanner & scanner, SymbolTable & symbols, Arena & arena);
 
 
 /*
  * Function: readE
- * Usage: Expression *exp = readE(scanner, prec);
- * ----------------------------------------------
+ * Usage: Expression *exp = readE(scanner, symbols, arena, prec);
+ * --------------------------------------------------------------
  * Returns the next expression from the scanner involving only operators
  * whose precedence is at least prec.  The prec argument is optional and
  * defaults to 0, which means that the function reads the entire expression.
  */
 
-Expression *readE(TokenScanner & scanner, int prec = 0);
+Expression *readE(TokenScanner & scanner, SymbolTable & symbols, Arena & arena, int prec = 0);
 
 /*
  * Function: readT
- * Usage: Expression *exp = readT(scanner);
- * ----------------------------------------
+ * Usage: Expression *exp = readT(scanner, symbols, arena);
+ * --------------------------------------------------------
  * Returns the next individual term, which is either a constant, an
  * identifier, or a parenthesized subexpression.
  */
 
-Expression *readT(TokenScanner & scanner);
+Expression *readT(TokenScanner & scanner, SymbolTable & symbols, Arena & arena);
 
 /*
  * Function: precedence
@@ -9,15 +9,20 @@
  */
 
 #include "program.h"
+#include "../StanfordCPPLib/error.h"
 #include "../StanfordCPPLib/tokenscanner.h"
+#include "fold.h"
 #include "parser.h"
 #include "statement.h"
 #include <algorithm>
+#include <iomanip>
 #include <set>
 #include <sstream>
 #include <string>
 using namespace std;
 
+static void countNodes(Expression *exp, long long &nodes, long long &bytes);
+
 /*
  * Implementation notes: the Program class
  * ----------------------------------------------
@@ -27,94 +32,82 @@ using namespace std;
 Program::Program()
 {
     this->executeLine = -1;
+    this->linked = false;
 }
 
 Program::~Program()
 {
-    programs.clear();
-    parsedStatements.clear();
+    clear();
 }
 
 void Program::clear()
 {
     executeLine = -1;
+    linked = false;
+    for (map<int, Arena *>::iterator it = arenas.begin(); it != arenas.end(); it++)
+        delete it->second;
+    arenas.clear();
     programs.clear();
     parsedStatements.clear();
+    symbols.clear();
+}
+
+SymbolTable &Program::getSymbolTable()
+{
+    return symbols;
 }
 
+/*
+ * Implementation notes: addSourceLine
+ * -----------------------------------
+ * The line is parsed into a fresh arena, which replaces the arena of
+ * the old line only once parsing has succeeded.  If parsing fails,
+ * whether by a SYNTAX ERROR or an exception, the new arena is deleted
+ * and the program is left as it was.
+ */
+
 void Program::addSourceLine(int lineNumber, string line, TokenScanner &ts)
 {
+    linked = false;
     ts.ignoreWhitespace();
     if (ts.hasMoreTokens())
     {
-        this->programs[lineNumber] = line;
+        Arena *arena = new Arena();
         Statement *tmp;
-        string str = ts.nextToken();
-        if (str == "REM")
-        {
-            tmp = new SeqREM();
-        }
-        else if (str == "LET")
-        {
-            Expression *exp = parseExp(ts);
-            tmp = new SeqLET(exp);
-        }
-        else if (str == "PRINT")
-        {
-            Expression *exp = parseExp(ts);
-            tmp = new SeqPRINT(exp);
-        }
-        else if (str == "INPUT")
-        {
-            string var = ts.nextToken();
-            tmp = new SeqINPUT(var);
-        }
-        else if (str == "END")
+        try
         {
-            tmp = new SeqEND();
+            tmp = parseStatement(ts.nextToken(), ts, *arena);
         }
-        else if (str == "GOTO")
+        catch (...)
         {
-            stringstream ss(ts.nextToken());
-            int line;
-            ss >> line;
-            tmp = new ControlGOTO(line, this);
+            delete arena;
+            throw;
         }
-        else if (str == "IF")
+        if (tmp == NULL)
         {
-            Expression *lhs = readE(ts, 1);
-            char cmp = ts.nextToken()[0];
-            Expression *rhs = readE(ts, 1);
-            if (ts.nextToken() != "THEN")
-            {
-                cout << "SYNTAX ERROR" << endl;
-            }
-            stringstream ss(ts.nextToken());
-            int line;
-            ss >> line;
-            tmp = new ControlIF(cmp, lhs, rhs, line, this);
-        }
-        else
+            delete arena;
             cout << "SYNTAX ERROR" << endl;
-        setParsedStatement(lineNumber, tmp);
+            return;
+        }
+        tmp->setLineNumber(lineNumber);
+        this->programs[lineNumber] = line;
+        setParsedStatement(lineNumber, tmp, arena);
         this->executeLine = this->programs.begin()->first;
     }
     else
     {
-        if (programs.count(lineNumber) == 1)
-        {
-            map<int, string>::iterator it = this->programs.find(lineNumber);
-            this->programs.erase(it);
-        }
+        removeSourceLine(lineNumber);
     }
 }
 
 void Program::removeSourceLine(int lineNumber)
 {
+    linked = false;
     if (this->programs.count(lineNumber) != 0)
     {
         map<int, string>::iterator it = this->programs.find(lineNumber);
         this->programs.erase(it);
+        removeParsedStatement(lineNumber);
     }
 }
 
@@ -127,12 +120,16 @@ string Program::getSourceLine(int lineNumber)
     return "";
 }
 
-void Program::setParsedStatement(int lineNumber, Statement *stmt)
+void Program::setParsedStatement(int lineNumber, Statement *stmt, Arena *arena)
 {
     if (this->programs.count(lineNumber) == 0)
         error("ERROR");
     else
+    {
+        removeParsedStatement(lineNumber);
         parsedStatements[lineNumber] = stmt;
+        arenas[lineNumber] = arena;
+    }
 }
 
 Statement *Program::getParsedStatement(int lineNumber)
@@ -196,4 +193,298 @@ void Program::initexecuteLine()
 void Program::renewexecuteLine()
 {
     this->executeLine = this->programs.begin()->first;
-}
\ No newline at end of file
+}
+
+/*
+ * Implementation notes: link
+ * --------------------------
+ * Linking walks the line map backward and then forward.  The backward
+ * walk links each line past the REM lines after it; a run of REM lines
+ * at the end of the program keeps its last line, so that a jump there
+ * still has a statement to land on and stop after.  The first line
+ * stays the head of the links even if it is a REM.  A jump to a missing
+ * line keeps a NULL target and is recorded in unresolvedLines.
+ *
+ * Reachability is found twice.  Before threading it gives the lines
+ * that can never run, for unreachableLines.  After threading it also
+ * leaves out the GOTOs every jump now goes past, and the links are
+ * redone over what is left.  A line that is left out only follows an
+ * END or a GOTO, neither of which falls through, so dropping it never
+ * changes where a statement continues.
+ */
+
+void Program::link()
+{
+    if (linked)
+        return;
+    unresolvedLines.clear();
+    unreachableLines.clear();
+    linked = true;
+    if (programs.empty())
+        return;
+    Statement *next = NULL;
+    for (map<int, string>::reverse_iterator it = programs.rbegin(); it != programs.rend(); it++)
+    {
+        Statement *stmt = parsedStatements[it->first];
+        stmt->setNext(next);
+        if (stmt->getType() != REM || next == NULL)
+            next = stmt;
+    }
+    for (map<int, string>::iterator it = programs.begin(); it != programs.end(); it++)
+    {
+        Statement *stmt = parsedStatements[it->first];
+        if (stmt->getType() == GOTO)
+        {
+            ControlGOTO *ctrl = (ControlGOTO *)stmt;
+            ctrl->setTarget(getLinkedTarget(ctrl->getTargetLine()));
+            if (ctrl->getTarget() == NULL)
+                unresolvedLines.push_back(it->first);
+        }
+        else if (stmt->getType() == IF)
+        {
+            ControlIF *ctrl = (ControlIF *)stmt;
+            ctrl->setTarget(getLinkedTarget(ctrl->getTargetLine()));
+            if (ctrl->getTarget() == NULL)
+                unresolvedLines.push_back(it->first);
+        }
+    }
+    set<Statement *> reachable;
+    findReachable(reachable);
+    for (map<int, string>::iterator it = programs.begin(); it != programs.end(); it++)
+    {
+        Statement *stmt = parsedStatements[it->first];
+        if (stmt->getType() != REM && reachable.count(stmt) == 0)
+            unreachableLines.push_back(it->first);
+    }
+    for (map<int, string>::iterator it = programs.begin(); it != programs.end(); it++)
+    {
+        Statement *stmt = parsedStatements[it->first];
+        if (stmt->getType() == GOTO)
+            ((ControlGOTO *)stmt)->setTarget(threadJump(((ControlGOTO *)stmt)->getTarget()));
+        else if (stmt->getType() == IF)
+            ((ControlIF *)stmt)->setTarget(threadJump(((ControlIF *)stmt)->getTarget()));
+    }
+    reachable.clear();
+    findReachable(reachable);
+    Statement *prev = NULL;
+    for (map<int, string>::iterator it = programs.begin(); it != programs.end(); it++)
+    {
+        Statement *stmt = parsedStatements[it->first];
+        if (reachable.count(stmt) == 0)
+            continue;
+        if (prev != NULL)
+            prev->setNext(stmt);
+        prev = stmt;
+    }
+    prev->setNext(NULL);
+}
+
+/*
+ * Implementation notes: findReachable
+ * -----------------------------------
+ * Adds to reachable every statement that a run from the first line
+ * can get to through the links.  END stops, a GOTO whose target exists
+ * only jumps, an IF can jump or fall through, and everything else,
+ * including a jump to a missing line, falls through.
+ */
+
+void Program::findReachable(set<Statement *> &reachable)
+{
+    vector<Statement *> work;
+    work.push_back(parsedStatements[programs.begin()->first]);
+    while (!work.empty())
+    {
+        Statement *stmt = work.back();
+        work.pop_back();
+        if (stmt == NULL || reachable.count(stmt) != 0)
+            continue;
+        reachable.insert(stmt);
+        if (stmt->getType() == END)
+            continue;
+        if (stmt->getType() == GOTO)
+        {
+            Statement *target = ((ControlGOTO *)stmt)->getTarget();
+            work.push_back(target != NULL ? target : stmt->getNext());
+            continue;
+        }
+        if (stmt->getType() == IF)
+            work.push_back(((ControlIF *)stmt)->getTarget());
+        work.push_back(stmt->getNext());
+    }
+}
+
+/*
+ * Implementation notes: threadJump
+ * --------------------------------
+ * Returns the statement that a jump to target ends up running first,
+ * following REM lines to the next line and GOTOs to a target that
+ * exists.  A chain that comes back to itself never gets anywhere, so
+ * such a jump keeps its target and loops just as it did.
+ */
+
+Statement *Program::threadJump(Statement *target)
+{
+    set<Statement *> seen;
+    Statement *stmt = target;
+    while (stmt != NULL && seen.count(stmt) == 0)
+    {
+        seen.insert(stmt);
+        if (stmt->getType() == REM && stmt->getNext() != NULL)
+            stmt = stmt->getNext();
+        else if (stmt->getType() == GOTO && ((ControlGOTO *)stmt)->getTarget() != NULL)
+            stmt = ((ControlGOTO *)stmt)->getTarget();
+        else
+            return stmt;
+    }
+    return target;
+}
+
+/*
+ * Implementation notes: parseStatement
+ * ------------------------------------
+ * Builds the statement that starts with keyword, reading the rest of
+ * the line from ts and allocating every node in arena.  Returns NULL
+ * if keyword does not start a statement.
+ */
+
+Statement *Program::parseStatement(string keyword, TokenScanner &ts, Arena &arena)
+{
+    if (keyword == "REM")
+        return new (arena) SeqREM();
+    if (keyword == "LET")
+    {
+        Expression *exp = parseExp(ts, symbols, arena);
+        foldOperands(exp, arena);
+        return new (arena) SeqLET(exp);
+    }
+    if (keyword == "PRINT")
+    {
+        Expression *exp = foldConstants(parseExp(ts, symbols, arena), arena);
+        return new (arena) SeqPRINT(exp);
+    }
+    if (keyword == "INPUT")
+    {
+        string var = ts.nextToken();
+        return new (arena) SeqINPUT(var, symbols.intern(var));
+    }
+    if (keyword == "END")
+        return new (arena) SeqEND();
+    if (keyword == "GOTO")
+    {
+        stringstream ss(ts.nextToken());
+        int line;
+        ss >> line;
+        return new (arena) ControlGOTO(line, this);
+    }
+    if (keyword == "IF")
+    {
+        Expression *lhs = foldConstants(readE(ts, symbols, arena, 1), arena);
+        char cmp = ts.nextToken()[0];
+        Expression *rhs = foldConstants(readE(ts, symbols, arena, 1), arena);
+        if (ts.nextToken() != "THEN")
+        {
+            cout << "SYNTAX ERROR" << endl;
+        }
+        stringstream ss(ts.nextToken());
+        int line;
+        ss >> line;
+        return new (arena) ControlIF(cmp, lhs, rhs, line, this);
+    }
+    return NULL;
+}
+
+/*
+ * Implementation notes: removeParsedStatement
+ * -------------------------------------------
+ * Deletes the arena of the line, which destroys its statement and
+ * expressions, and forgets both.
+ */
+
+void Program::removeParsedStatement(int lineNumber)
+{
+    map<int, Arena *>::iterator it = arenas.find(lineNumber);
+    if (it == arenas.end())
+        return;
+    delete it->second;
+    arenas.erase(it);
+    parsedStatements.erase(lineNumber);
+}
+
+Statement *Program::getLinkedTarget(int lineNumber)
+{
+    if (programs.count(lineNumber) == 0)
+        return NULL;
+    return parsedStatements[lineNumber];
+}
+
+Statement *Program::getLinkedStatement(int lineNumber)
+{
+    map<int, string>::iterator it = programs.lower_bound(lineNumber);
+    if (it == programs.end())
+        return NULL;
+    return parsedStatements[it->first];
+}
+
+vector<int> Program::getUnresolvedLines()
+{
+    return unresolvedLines;
+}
+
+vector<int> Program::getUnreachableLines()
+{
+    return unreachableLines;
+}
+
+/*
+ * Implementation notes: reportMemory
+ * ----------------------------------
+ * The nodes are counted by walking the expressions of every line, so
+ * nodes that folding dropped only show up in the arena total.
+ */
+
+void Program::reportMemory(ostream &os)
+{
+    long long nodes = 0;
+    long long bytes = 0;
+    long long arenaBytes = 0;
+    for (map<int, Statement *>::iterator it = parsedStatements.begin(); it != parsedStatements.end(); it++)
+    {
+        Statement *stmt = it->second;
+        if (stmt->getType() == LET)
+            countNodes(((SeqLET *)stmt)->getExp(), nodes, bytes);
+        else if (stmt->getType() == PRINT)
+            countNodes(((SeqPRINT *)stmt)->getExp(), nodes, bytes);
+        else if (stmt->getType() == IF)
+        {
+            countNodes(((ControlIF *)stmt)->getLHS(), nodes, bytes);
+            countNodes(((ControlIF *)stmt)->getRHS(), nodes, bytes);
+        }
+    }
+    for (map<int, Arena *>::iterator it = arenas.begin(); it != arenas.end(); it++)
+        arenaBytes += it->second->getBytesUsed();
+    os << "lines: " << programs.size() << endl;
+    os << "expression nodes: " << nodes << endl;
+    os << "expression bytes: " << bytes << endl;
+    if (nodes != 0)
+        os << "bytes per node: " << fixed << setprecision(1) << (double)bytes / nodes << endl;
+    os << "arena bytes: " << arenaBytes << endl;
+}
+
+static void countNodes(Expression *exp, long long &nodes, long long &bytes)
+{
+    nodes++;
+    switch (exp->getType())
+    {
+    case CONSTANT:
+        bytes += sizeof(ConstantExp);
+        break;
+    case IDENTIFIER:
+        bytes += sizeof(IdentifierExp);
+        break;
+    case COMPOUND:
+        bytes += sizeof(CompoundExp);
+        countNodes(((CompoundExp *)exp)->getLHS(), nodes, bytes);
+        countNodes(((CompoundExp *)exp)->getRHS(), nodes, bytes);
+        break;
+    }
+}
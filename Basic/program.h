@@ -9,8 +9,12 @@
 #define _program_h
 
 #include "../StanfordCPPLib/tokenscanner.h"
+#include "arena.h"
 #include "statement.h"
+#include "symtab.h"
+#include <iostream>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 using namespace std;
@@ -26,7 +30,9 @@ class Statement;
  *    line number) that was entered by the user.
  *
  * 2. The parsed representation of that statement, which is a
- *    pointer to a Statement.
+ *    pointer to a Statement.  The statement and its expressions are
+ *    allocated in an Arena that belongs to the line, so replacing or
+ *    removing the line frees them all at once.
  */
 
 class Program
@@ -46,7 +52,8 @@ public:
  * Destructor: ~Program
  * Usage: usually implicit
  * -----------------------
- * Frees any heap storage associated with the program.
+ * Frees any heap storage associated with the program.  The program
+ * owns the arenas of its lines, so it cannot be copied.
  */
 
   ~Program();
@@ -97,15 +104,17 @@ public:
 
   /*
  * Method: setParsedStatement
- * Usage: program.setParsedStatement(lineNumber, stmt);
- * ----------------------------------------------------
+ * Usage: program.setParsedStatement(lineNumber, stmt, arena);
+ * -----------------------------------------------------------
  * Adds the parsed representation of the statement to the statement
- * at the specified line number.  If no such line exists, this
+ * at the specified line number.  The statement must be allocated in
+ * arena, which the program takes over.  If no such line exists, this
  * method raises an error.  If a previous parsed representation
- * exists, the memory for that statement is reclaimed.
+ * exists, its arena is deleted, reclaiming the memory for that
+ * statement.
  */
 
-  void setParsedStatement(int lineNumber, Statement *stmt);
+  void setParsedStatement(int lineNumber, Statement *stmt, Arena *arena);
 
   /*
  * Method: getParsedStatement
@@ -177,10 +186,95 @@ public:
 
   void renewexecuteLine();
 
+  /*
+ * Method: link
+ * Usage: program.link();
+ * ------------------------------------------------------------
+ * Links every statement to the statement on the following line and
+ * every GOTO and IF to the statement at its target line, so that a
+ * running program never has to look up a line number.  Jumps are
+ * threaded through the GOTO and REM lines they land on, and REM lines
+ * and the lines that no path from the first line reaches are left out
+ * of the links, so that running the program never visits them.  The
+ * links are kept until the program is edited; calling link
+ * again before that does nothing.
+ */
+
+  void link();
+
+  /*
+ * Method: getLinkedStatement
+ * Usage: Statement *stmt = program.getLinkedStatement(lineNumber);
+ * ------------------------------------------------------------
+ * Returns the statement of the first line whose number is at least
+ * lineNumber, or NULL if there is none.  The program must be linked.
+ */
+
+  Statement *getLinkedStatement(int lineNumber);
+
+  /*
+ * Method: getUnresolvedLines
+ * Usage: vector<int> lines = program.getUnresolvedLines();
+ * ------------------------------------------------------------
+ * Returns the lines holding a GOTO or IF whose target line does not
+ * exist, as found by the last call to link.  Such a jump reports
+ * LINE NUMBER ERROR when it is taken.
+ */
+
+  vector<int> getUnresolvedLines();
+
+  /*
+ * Method: getUnreachableLines
+ * Usage: vector<int> lines = program.getUnreachableLines();
+ * ------------------------------------------------------------
+ * Returns the lines other than REM that no run of the program can
+ * reach from its first line, following every GOTO and both ways out
+ * of every IF, as found by the last call to link.
+ */
+
+  vector<int> getUnreachableLines();
+
+  /*
+ * Method: getSymbolTable
+ * Usage: SymbolTable &symbols = program.getSymbolTable();
+ * ------------------------------------------------------------
+ * Returns the table that numbers the variables of the program.  All
+ * the lines of the program, and the immediate-mode statements run
+ * against it, are parsed with this table.  clear empties it.
+ */
+
+  SymbolTable &getSymbolTable();
+
+  /*
+ * Method: reportMemory
+ * Usage: program.reportMemory(cerr);
+ * ------------------------------------------------------------
+ * Writes to os how many lines and expression nodes the program has,
+ * the bytes the nodes take and the bytes held by the arenas of all
+ * lines, which also covers the statements and any nodes the constant
+ * folder dropped.
+ */
+
+  void reportMemory(ostream &os);
+
 private:
+  Program(const Program &);
+  Program &operator=(const Program &);
+
+  Statement *parseStatement(string keyword, TokenScanner &ts, Arena &arena);
+  void removeParsedStatement(int lineNumber);
+  Statement *getLinkedTarget(int lineNumber);
+  Statement *threadJump(Statement *target);
+  void findReachable(set<Statement *> &reachable);
+
   int executeLine;
+  bool linked;
+  vector<int> unresolvedLines;
+  vector<int> unreachableLines;
   map<int, string> programs;
   map<int, Statement *> parsedStatements;
+  map<int, Arena *> arenas;
+  SymbolTable symbols;
 };
 
 #endif
@@ -0,0 +1,496 @@
+/*
+ * File: range.cpp
+ * ---------------
+ * This file implements the value-range analysis.
+ */
+
+#include "range.h"
+#include "cfg.h"
+#include "exp.h"
+#include "statement.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <set>
+#include <vector>
+using namespace std;
+
+/*
+ * Constant: WIDEN_AFTER
+ * ---------------------
+ * The number of times the entry facts of a block may grow before any
+ * bound that still moves is widened.  A few exact rounds keep short
+ * loops precise; widening then makes the iteration finish.
+ */
+
+static const int WIDEN_AFTER = 3;
+
+static ValueRange makeRange(long long lo, long long hi, bool nonzero = false);
+static ValueRange fullRange();
+static ValueRange join(const ValueRange &a, const ValueRange &b);
+static ValueRange intersect(const ValueRange &a, const ValueRange &b);
+static ValueRange exclude(const ValueRange &a, const ValueRange &b);
+static ValueRange arithmetic(OperatorType op, const ValueRange &a, const ValueRange &b);
+static bool isEmpty(const ValueRange &range);
+static bool sameRange(const ValueRange &a, const ValueRange &b);
+
+bool ValueRange::excludesZero() const
+{
+    return nonzero || lo > 0 || hi < 0;
+}
+
+bool ValueRange::isNonNegative() const
+{
+    return lo >= 0;
+}
+
+bool ValueRange::isBounded() const
+{
+    return lo > INT_MIN || hi < INT_MAX;
+}
+
+/*
+ * Implementation notes: RangeAnalysis
+ * -----------------------------------
+ * This is a forward dataflow problem over the basic blocks, like the
+ * definedness analysis, but the facts are intervals and the edges out
+ * of an IF carry different facts.  A block is unreachable until some
+ * edge reaches it; its entry facts are then the join of all incoming
+ * edges.  A bound that keeps moving is widened to the next constant of
+ * the program, or one past it, so a loop counter stops at the limit
+ * its IF tests instead of running into the end of the int range, where
+ * the increment would wrap.  A last pass replays every block and
+ * writes the marks; the blocks RUN can never reach are replayed with
+ * nothing known, so their divisions keep the check.
+ */
+
+RangeAnalysis::RangeAnalysis(ControlFlowGraph &cfg, const vector<bool> &entryDefined, const vector<int> &entryValues, int reservedCount)
+{
+    this->reservedCount = reservedCount;
+    vector<BasicBlock *> &blocks = cfg.getBlocks();
+    int n = blocks.size();
+    Environment unreached;
+    unreached.reachable = false;
+    in.assign(n, unreached);
+    visits.assign(n, 0);
+    BasicBlock *entry = cfg.getEntry();
+    if (entry != NULL)
+    {
+        Environment &start = in[entry->getId()];
+        start.reachable = true;
+        for (int slot = 0; slot < entryDefined.size(); slot++)
+        {
+            int value = entryDefined[slot] ? entryValues[slot] : 0;
+            start.vars.push_back(makeRange(value, value));
+        }
+    }
+    thresholds.insert(INT_MIN);
+    thresholds.insert(INT_MAX);
+    for (int i = 0; i < n; i++)
+    {
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+        {
+            Statement *stmt = stmts[j];
+            if (stmt->getType() == LET)
+                collectThresholds(((SeqLET *)stmt)->getExp());
+            else if (stmt->getType() == PRINT)
+                collectThresholds(((SeqPRINT *)stmt)->getExp());
+            else if (stmt->getType() == IF)
+            {
+                collectThresholds(((ControlIF *)stmt)->getLHS());
+                collectThresholds(((ControlIF *)stmt)->getRHS());
+            }
+        }
+    }
+
+    changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < n; i++)
+        {
+            if (!in[i].reachable)
+                continue;
+            BasicBlock *block = blocks[i];
+            Environment env = in[i];
+            vector<Statement *> &stmts = block->getStatements();
+            for (int j = 0; j < stmts.size(); j++)
+                transfer(stmts[j], env, false);
+            Statement *last = block->getLast();
+            if (last->getType() == IF && block->getBranch() != NULL)
+            {
+                Environment taken = env;
+                refine((ControlIF *)last, taken, true);
+                propagate(block->getBranch(), taken);
+                refine((ControlIF *)last, env, false);
+            }
+            else if (block->getBranch() != NULL)
+            {
+                propagate(block->getBranch(), env);
+            }
+            if (block->getFallthrough() != NULL)
+                propagate(block->getFallthrough(), env);
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        Environment env = in[i];
+        if (!env.reachable)
+        {
+            env.reachable = true;
+            env.vars.assign(entryDefined.size(), fullRange());
+        }
+        vector<Statement *> &stmts = blocks[i]->getStatements();
+        for (int j = 0; j < stmts.size(); j++)
+            transfer(stmts[j], env, true);
+    }
+}
+
+ValueRange RangeAnalysis::getRange(Expression *exp)
+{
+    map<Expression *, ValueRange>::iterator it = ranges.find(exp);
+    if (it == ranges.end())
+        return fullRange();
+    return it->second;
+}
+
+/*
+ * Implementation notes: evaluate
+ * ------------------------------
+ * Mirrors Expression::eval on intervals, visiting the operands in the
+ * same order so that an assignment nested in an operand is seen by the
+ * reads after it.  Every failing path of eval returns 0, which is why
+ * a division that may fail includes 0 in its result.
+ */
+
+ValueRange RangeAnalysis::evaluate(Expression *exp, Environment &env, bool record)
+{
+    ValueRange result;
+    if (exp->getType() == CONSTANT)
+    {
+        int value = ((ConstantExp *)exp)->getValue();
+        result = makeRange(value, value);
+    }
+    else if (exp->getType() == IDENTIFIER)
+    {
+        result = env.vars[((IdentifierExp *)exp)->getSlot()];
+    }
+    else
+    {
+        CompoundExp *cexp = (CompoundExp *)exp;
+        OperatorType op = cexp->getOperator();
+        if (op == ASSIGN_OP)
+        {
+            if (cexp->getLHS()->getType() != IDENTIFIER)
+            {
+                result = makeRange(0, 0);
+            }
+            else
+            {
+                result = evaluate(cexp->getRHS(), env, record);
+                int slot = ((IdentifierExp *)cexp->getLHS())->getSlot();
+                if (slot >= reservedCount)
+                    env.vars[slot] = result;
+            }
+        }
+        else
+        {
+            ValueRange left = evaluate(cexp->getLHS(), env, record);
+            ValueRange right = evaluate(cexp->getRHS(), env, record);
+            result = arithmetic(op, left, right);
+            if (record && op == DIV_OP)
+                cexp->setDivisorNonzero(right.excludesZero());
+        }
+    }
+    if (record)
+        ranges[exp] = result;
+    return result;
+}
+
+/*
+ * Method: transfer
+ * ----------------
+ * Updates env across one statement.
+ */
+
+void RangeAnalysis::transfer(Statement *stmt, Environment &env, bool record)
+{
+    switch (stmt->getType())
+    {
+    case LET:
+        evaluate(((SeqLET *)stmt)->getExp(), env, record);
+        break;
+    case PRINT:
+        evaluate(((SeqPRINT *)stmt)->getExp(), env, record);
+        break;
+    case INPUT:
+    {
+        int slot = ((SeqINPUT *)stmt)->getSlot();
+        if (slot >= reservedCount)
+            env.vars[slot] = fullRange();
+        break;
+    }
+    case IF:
+        evaluate(((ControlIF *)stmt)->getLHS(), env, record);
+        evaluate(((ControlIF *)stmt)->getRHS(), env, record);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Implementation notes: refine
+ * ----------------------------
+ * Narrows env to the values for which the comparison of ctrl comes out
+ * as taken says.  Only operands that are variables or constants are
+ * used, since evaluating them changes nothing, so the value compared
+ * is still the value of the variable afterwards.  A comparison that
+ * cannot come out that way makes the edge unreachable; an unknown
+ * comparison character never jumps.
+ */
+
+void RangeAnalysis::refine(ControlIF *ctrl, Environment &env, bool taken)
+{
+    char cmp = ctrl->getCmp();
+    if (cmp != '<' && cmp != '>' && cmp != '=')
+    {
+        if (taken)
+            env.reachable = false;
+        return;
+    }
+    Expression *lhs = ctrl->getLHS();
+    Expression *rhs = ctrl->getRHS();
+    if ((lhs->getType() != IDENTIFIER && lhs->getType() != CONSTANT) || (rhs->getType() != IDENTIFIER && rhs->getType() != CONSTANT))
+        return;
+    ValueRange left = evaluate(lhs, env, false);
+    ValueRange right = evaluate(rhs, env, false);
+    if (cmp == '>')
+    {
+        swap(lhs, rhs);
+        swap(left, right);
+    }
+
+    ValueRange newLeft, newRight;
+    if (cmp == '=' && taken)
+    {
+        newLeft = newRight = intersect(left, right);
+    }
+    else if (cmp == '=')
+    {
+        newLeft = exclude(left, right);
+        newRight = exclude(right, left);
+    }
+    else if (taken)
+    {
+        newLeft = intersect(left, makeRange(INT_MIN, right.hi - 1));
+        newRight = intersect(right, makeRange(left.lo + 1, INT_MAX));
+    }
+    else
+    {
+        newLeft = intersect(left, makeRange(right.lo, INT_MAX));
+        newRight = intersect(right, makeRange(INT_MIN, left.hi));
+    }
+    if (isEmpty(newLeft) || isEmpty(newRight))
+    {
+        env.reachable = false;
+        return;
+    }
+    if (lhs->getType() == IDENTIFIER)
+    {
+        ValueRange &var = env.vars[((IdentifierExp *)lhs)->getSlot()];
+        var = intersect(var, newLeft);
+    }
+    if (rhs->getType() == IDENTIFIER)
+    {
+        ValueRange &var = env.vars[((IdentifierExp *)rhs)->getSlot()];
+        var = intersect(var, newRight);
+    }
+}
+
+/*
+ * Method: propagate
+ * -----------------
+ * Joins the facts env leaving a block along one edge into the entry
+ * facts of the block to, widening once it has grown often enough.
+ */
+
+void RangeAnalysis::propagate(BasicBlock *to, Environment &env)
+{
+    if (!env.reachable)
+        return;
+    Environment &target = in[to->getId()];
+    if (!target.reachable)
+    {
+        target = env;
+        visits[to->getId()]++;
+        changed = true;
+        return;
+    }
+    bool grew = false;
+    for (int slot = 0; slot < target.vars.size(); slot++)
+    {
+        ValueRange &old = target.vars[slot];
+        ValueRange joined = join(old, env.vars[slot]);
+        if (visits[to->getId()] >= WIDEN_AFTER)
+        {
+            if (joined.lo < old.lo)
+                joined.lo = *--thresholds.upper_bound(joined.lo);
+            if (joined.hi > old.hi)
+                joined.hi = *thresholds.lower_bound(joined.hi);
+            joined = makeRange(joined.lo, joined.hi, joined.nonzero);
+        }
+        if (!sameRange(joined, old))
+        {
+            old = joined;
+            grew = true;
+        }
+    }
+    if (grew)
+    {
+        visits[to->getId()]++;
+        changed = true;
+    }
+}
+
+/*
+ * Method: collectThresholds
+ * -------------------------
+ * Adds every constant of exp, and its neighbours, to the bounds that
+ * widening may stop at.
+ */
+
+void RangeAnalysis::collectThresholds(Expression *exp)
+{
+    if (exp->getType() == CONSTANT)
+    {
+        long long value = ((ConstantExp *)exp)->getValue();
+        for (long long t = value - 1; t <= value + 1; t++)
+        {
+            if (t >= INT_MIN && t <= INT_MAX)
+                thresholds.insert(t);
+        }
+    }
+    else if (exp->getType() == COMPOUND)
+    {
+        collectThresholds(((CompoundExp *)exp)->getLHS());
+        collectThresholds(((CompoundExp *)exp)->getRHS());
+    }
+}
+
+/*
+ * Function: makeRange
+ * -------------------
+ * Returns the interval lo to hi, with the nonzero bit set whenever it
+ * holds and an endpoint at 0 dropped when it is set.
+ */
+
+static ValueRange makeRange(long long lo, long long hi, bool nonzero)
+{
+    ValueRange range;
+    if (nonzero && lo == 0)
+        lo = 1;
+    if (nonzero && hi == 0)
+        hi = -1;
+    range.lo = lo;
+    range.hi = hi;
+    range.nonzero = nonzero || lo > 0 || hi < 0;
+    return range;
+}
+
+static ValueRange fullRange()
+{
+    return makeRange(INT_MIN, INT_MAX);
+}
+
+static ValueRange join(const ValueRange &a, const ValueRange &b)
+{
+    return makeRange(min(a.lo, b.lo), max(a.hi, b.hi), a.excludesZero() && b.excludesZero());
+}
+
+static ValueRange intersect(const ValueRange &a, const ValueRange &b)
+{
+    return makeRange(max(a.lo, b.lo), min(a.hi, b.hi), a.excludesZero() || b.excludesZero());
+}
+
+/*
+ * Function: exclude
+ * -----------------
+ * Returns a without the value of b, for the edge on which a = b is
+ * false.  Only a single value can be taken out, and only if it is 0 or
+ * an endpoint of a.
+ */
+
+static ValueRange exclude(const ValueRange &a, const ValueRange &b)
+{
+    if (b.lo != b.hi)
+        return a;
+    long long lo = a.lo, hi = a.hi;
+    if (lo == b.lo)
+        lo++;
+    if (hi == b.lo)
+        hi--;
+    return makeRange(lo, hi, a.excludesZero() || b.lo == 0);
+}
+
+/*
+ * Implementation notes: arithmetic
+ * --------------------------------
+ * The bounds are computed in 64 bits, which is wide enough for any
+ * product of two ints.  A result that does not fit may wrap around to
+ * anything, so it becomes the whole range.  A product of two nonzero
+ * values stays nonzero only when it cannot wrap.  A division can
+ * return 0 through DIVIDE BY ZERO and never grows in magnitude;
+ * INT_MIN / -1 traps, so it needs no range of its own.
+ */
+
+static ValueRange arithmetic(OperatorType op, const ValueRange &a, const ValueRange &b)
+{
+    long long lo, hi;
+    bool nonzero = false;
+    switch (op)
+    {
+    case ADD_OP:
+        lo = a.lo + b.lo;
+        hi = a.hi + b.hi;
+        break;
+    case SUB_OP:
+        lo = a.lo - b.hi;
+        hi = a.hi - b.lo;
+        break;
+    case MUL_OP:
+    {
+        long long corners[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+        lo = *min_element(corners, corners + 4);
+        hi = *max_element(corners, corners + 4);
+        nonzero = a.excludesZero() && b.excludesZero();
+        break;
+    }
+    case DIV_OP:
+    {
+        if (b.lo == 0 && b.hi == 0)
+            return makeRange(0, 0);
+        long long magnitude = max(-a.lo, a.hi);
+        lo = (a.lo >= 0 && b.lo >= 0) ? 0 : -magnitude;
+        hi = magnitude;
+        break;
+    }
+    default:
+        return makeRange(0, 0);
+    }
+    if (lo < INT_MIN || hi > INT_MAX)
+        return fullRange();
+    return makeRange(lo, hi, nonzero);
+}
+
+static bool isEmpty(const ValueRange &range)
+{
+    return range.lo > range.hi;
+}
+
+static bool sameRange(const ValueRange &a, const ValueRange &b)
+{
+    return a.lo == b.lo && a.hi == b.hi && a.nonzero == b.nonzero;
+}
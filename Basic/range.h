@@ -0,0 +1,107 @@
+/*
+ * File: range.h
+ * -------------
+ * This interface exports the value-range analysis, which bounds the
+ * value of every expression in a program and finds the divisions
+ * whose divisor can never be zero.
+ */
+
+#ifndef _range_h
+#define _range_h
+
+#include "cfg.h"
+#include "exp.h"
+#include <map>
+#include <set>
+#include <vector>
+using namespace std;
+
+/*
+ * Type: ValueRange
+ * ----------------
+ * An interval of int values, lo to hi inclusive, together with a bit
+ * that records that the value is not zero even though zero lies in
+ * the interval, as after IF p = 0 falls through.
+ */
+
+struct ValueRange
+{
+  long long lo;
+  long long hi;
+  bool nonzero;
+
+  /*
+ * Methods: excludesZero, isNonNegative, isBounded
+ * Usage: if (range.excludesZero()) . . .
+ * -----------------------
+ * Return whether the value is never 0, never negative, and whether
+ * the interval is narrower than the whole int range.
+ */
+
+  bool excludesZero() const;
+  bool isNonNegative() const;
+  bool isBounded() const;
+};
+
+/*
+ * Class: RangeAnalysis
+ * --------------------
+ * This class runs an interval analysis over the basic blocks of a
+ * program.  The values variables have when RUN starts are the initial
+ * facts; an undefined variable reads as 0.  IF statements comparing a
+ * variable with a constant or another variable narrow the ranges on
+ * each outgoing edge, and loops are made to converge by widening.
+ *
+ * Every division whose divisor is proven nonzero is marked with
+ * setDivisorNonzero, and every other one is unmarked, so the marks of
+ * an earlier RUN never survive.
+ */
+
+class RangeAnalysis
+{
+
+public:
+  /*
+ * Constructor: RangeAnalysis
+ * Usage: RangeAnalysis ranges(cfg, entryDefined, entryValues, reservedCount);
+ * -----------------------
+ * Analyzes the program of cfg and marks its divisions.  entryDefined
+ * and entryValues have one element per slot of the program's
+ * SymbolTable and give the variables defined when the program starts
+ * and their values.  reservedCount is the number of keyword slots.
+ */
+
+  RangeAnalysis(ControlFlowGraph &cfg, const vector<bool> &entryDefined, const vector<int> &entryValues, int reservedCount);
+
+  /*
+ * Method: getRange
+ * Usage: ValueRange range = ranges.getRange(exp);
+ * -----------------------
+ * Returns the range of the values exp can evaluate to, or the whole
+ * int range for an expression the analysis did not reach.
+ */
+
+  ValueRange getRange(Expression *exp);
+
+private:
+  struct Environment
+  {
+    bool reachable;
+    vector<ValueRange> vars;
+  };
+
+  ValueRange evaluate(Expression *exp, Environment &env, bool record);
+  void transfer(Statement *stmt, Environment &env, bool record);
+  void refine(ControlIF *ctrl, Environment &env, bool taken);
+  void propagate(BasicBlock *to, Environment &env);
+  void collectThresholds(Expression *exp);
+
+  vector<Environment> in;
+  vector<int> visits;
+  map<Expression *, ValueRange> ranges;
+  set<long long> thresholds;
+  int reservedCount;
+  bool changed;
+};
+
+#endif
@@ -0,0 +1,586 @@
+/*
+ * File: regvm.cpp
+ * ---------------
+ * This file implements the RegisterCode and RegisterMachine classes.
+ */
+
+#include "regvm.h"
+#include "closedform.h"
+#include "evalstate.h"
+#include "exp.h"
+#include "fold.h"
+#include "loops.h"
+#include "program.h"
+#include "statement.h"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Implementation notes: register numbering
+ * ----------------------------------------
+ * Registers 0 .. variableCount-1 are the variables, indexed by their
+ * SymbolTable slot, and are followed by the temporaries.  The number
+ * of constants is only known once the whole program is compiled, so
+ * while compiling constant k is written as the register -(k + 1) and
+ * moved behind the temporaries at the end.
+ */
+
+static bool assigns(Expression *exp, int slot);
+
+RegisterCode::RegisterCode(Program &program, LoopInvariants *loops)
+{
+    program.link();
+    variableCount = program.getSymbolTable().size();
+    reservedCount = program.getSymbolTable().getReservedCount();
+    temporaryCount = 0;
+    current = NULL;
+    this->loops = loops;
+    map<Statement *, int> loopAddresses;
+    Statement *stmt = program.getLinkedStatement(program.getFirstLineNumber());
+    for (; stmt != NULL; stmt = stmt->getNext())
+    {
+        lines[stmt->getLineNumber()] = code.size();
+        if (loops != NULL && (!loops->getPreheader(stmt).empty() || !loops->getReductions(stmt).empty() || loops->getClosedForm(stmt) != NULL))
+        {
+            if (loops->getClosedForm(stmt) != NULL)
+            {
+                closedForms.push_back(loops->getClosedForm(stmt));
+                emit(REG_CLOSED_FORM, closedForms.size() - 1);
+            }
+            vector<CompoundExp *> &hoisted = loops->getPreheader(stmt);
+            for (int i = 0; i < hoisted.size(); i++)
+                emit(REG_MOVE, hoisted[i]->getHoistedSlot(), compileCompound(hoisted[i], 0));
+            vector<LoopInvariants::Reduction> &reductions = loops->getReductions(stmt);
+            for (int i = 0; i < reductions.size(); i++)
+                emit(REG_MOVE, reductions[i].slot, compileCompound(reductions[i].exp, 0));
+            loopAddresses[stmt] = code.size();
+        }
+        current = stmt;
+        if (loops != NULL && loops->isCountedLoop(stmt))
+        {
+            Statement *test = stmt->getNext();
+            compileCountedLoop(stmt, (ControlIF *)test);
+            stmt = test;
+            continue;
+        }
+        compileStatement(stmt);
+        if (loops != NULL)
+        {
+            vector<LoopInvariants::Reduction> &updates = loops->getUpdates(stmt);
+            for (int i = 0; i < updates.size(); i++)
+                emit(REG_ADD, updates[i].slot, updates[i].slot, addConstant(updates[i].step));
+        }
+    }
+    emit(REG_HALT, 0);
+
+    /*
+     * Unresolved jumps report LINE NUMBER ERROR and fall through.  Back
+     * edges skip the preheader of their loop.
+     */
+    for (int i = 0; i < jumps.size(); i++)
+    {
+        int target;
+        if (loopAddresses.count(jumps[i].target) != 0 && loops->isBackEdge(jumps[i].from, jumps[i].target))
+            target = loopAddresses[jumps[i].target];
+        else if (jumps[i].target != NULL)
+            target = lines[jumps[i].target->getLineNumber()];
+        else
+        {
+            target = code.size();
+            emit(REG_LINE_ERROR, 0);
+            emit(REG_JUMP, jumps[i].pc + 1);
+        }
+        code[jumps[i].pc].dst = target;
+    }
+    jumps.clear();
+
+    int constantBase = variableCount + temporaryCount;
+    for (int i = 0; i < code.size(); i++)
+    {
+        if (code[i].a < 0)
+            code[i].a = constantBase - code[i].a - 1;
+        if (code[i].b < 0)
+            code[i].b = constantBase - code[i].b - 1;
+        if (code[i].c < 0)
+            code[i].c = constantBase - code[i].c - 1;
+    }
+}
+
+int RegisterCode::getLineAddress(int line)
+{
+    map<int, int>::iterator it = lines.find(line);
+    if (it == lines.end())
+        return -1;
+    return it->second;
+}
+
+void RegisterCode::compileStatement(Statement *stmt)
+{
+    switch (stmt->getType())
+    {
+    case REM:
+        break;
+    case LET:
+    {
+        if (((SeqLET *)stmt)->isDead())
+            break;
+        Expression *exp = ((SeqLET *)stmt)->getExp();
+        if (exp->getType() != COMPOUND)
+            emit(REG_NOT_COMPOUND, 0);
+        compileExp(exp, 0);
+        break;
+    }
+    case PRINT:
+    {
+        Expression *exp = ((SeqPRINT *)stmt)->getExp();
+        int r = compileExp(exp, 0);
+        emit(hasConstantFlag(exp) ? REG_PRINT : REG_PRINT_FLAG, 0, r);
+        break;
+    }
+    case INPUT:
+        emit(REG_INPUT, ((SeqINPUT *)stmt)->getSlot());
+        break;
+    case END:
+        emit(REG_HALT, 0);
+        break;
+    case GOTO:
+        emitJump(REG_JUMP, ((ControlGOTO *)stmt)->getTarget());
+        break;
+    case IF:
+    {
+        ControlIF *ctrl = (ControlIF *)stmt;
+        Idiom &idiom = ctrl->getIdiom();
+        if (idiom.type == ABS_IDIOM)
+            emit(REG_ABS, idiom.a);
+        else if (idiom.type == MAX_IDIOM || idiom.type == MIN_IDIOM)
+            emit(idiom.type == MAX_IDIOM ? REG_MAX : REG_MIN, idiom.a, compileExp(idiom.operand, 0));
+        else if (idiom.type == GCD_IDIOM)
+            emit(REG_GCD, idiom.a, idiom.b, idiom.t);
+        if (idiom.type != NO_IDIOM)
+        {
+            emitJump(REG_JUMP, ctrl->getTarget());
+            break;
+        }
+        int a = compileExp(ctrl->getLHS(), 0);
+        if (a >= 0 && a < variableCount && assigns(ctrl->getRHS(), a))
+        {
+            emit(REG_MOVE, variableCount, a);
+            a = variableCount;
+        }
+        int b = compileExp(ctrl->getRHS(), 1);
+        switch (ctrl->getCmp())
+        {
+        case '>':
+            emitJump(REG_JUMP_GT, ctrl->getTarget(), a, b);
+            break;
+        case '<':
+            emitJump(REG_JUMP_LT, ctrl->getTarget(), a, b);
+            break;
+        case '=':
+            emitJump(REG_JUMP_EQ, ctrl->getTarget(), a, b);
+            break;
+        default:
+            emit(REG_BAD_CMP, 0);
+        }
+        break;
+    }
+    }
+}
+
+/*
+ * Implementation notes: compileCountedLoop
+ * ----------------------------------------
+ * Compiles an increment and the test that follows it as one REG_LOOP
+ * instruction.  The reduced products are advanced first; nothing
+ * between there and the increment reads them.  The limit of the test
+ * is a constant, a proven variable or a hoisted expression, so
+ * compileExp emits no code for it.
+ */
+
+void RegisterCode::compileCountedLoop(Statement *increment, ControlIF *test)
+{
+    vector<LoopInvariants::Reduction> &updates = loops->getUpdates(increment);
+    for (int i = 0; i < updates.size(); i++)
+        emit(REG_ADD, updates[i].slot, updates[i].slot, addConstant(updates[i].step));
+    CompoundExp *exp = (CompoundExp *)((SeqLET *)increment)->getExp();
+    int slot = ((IdentifierExp *)exp->getLHS())->getSlot();
+    int step = loops->getStep(increment);
+    current = test;
+    int limit = compileExp(test->getRHS(), 1);
+    switch (test->getCmp())
+    {
+    case '>':
+        emitJump(REG_LOOP_GT, test->getTarget(), slot, limit, addConstant(step));
+        break;
+    case '<':
+        emitJump(REG_LOOP_LT, test->getTarget(), slot, limit, addConstant(step));
+        break;
+    default:
+        emitJump(REG_LOOP_EQ, test->getTarget(), slot, limit, addConstant(step));
+    }
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Returns the register that holds the value of exp.  Leaves need no
+ * instruction besides REG_CHECK, which is left out for variables the
+ * definedness analysis has proven: a variable is read straight from
+ * its own register and a constant from the constant pool.  temp is the
+ * first temporary not in use by the enclosing expression.
+ *
+ * Since a variable operand is read when the operator executes rather
+ * than when the tree walker would load it, a left operand is saved to
+ * a temporary if the right operand assigns to it, as in x + (x = 1).
+ * A hoisted or strength-reduced expression is read from the register
+ * of its hidden slot.
+ */
+
+int RegisterCode::compileExp(Expression *exp, int temp)
+{
+    if (temp + 1 > temporaryCount)
+        temporaryCount = temp + 1;
+    switch (exp->getType())
+    {
+    case CONSTANT:
+        return addConstant(((ConstantExp *)exp)->getValue());
+    case IDENTIFIER:
+    {
+        IdentifierExp *id = (IdentifierExp *)exp;
+        if (!id->isProvenDefined())
+            emit(REG_CHECK, id->getSlot());
+        return id->getSlot();
+    }
+    default:
+        break;
+    }
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getHoistedSlot() >= 0)
+        return cexp->getHoistedSlot();
+    if (loops != NULL && loops->getReducedSlot(cexp) >= 0)
+        return loops->getReducedSlot(cexp);
+    return compileCompound(cexp, temp);
+}
+
+int RegisterCode::compileCompound(CompoundExp *cexp, int temp)
+{
+    int dst = variableCount + temp;
+    if (temp + 1 > temporaryCount)
+        temporaryCount = temp + 1;
+    if (cexp->isRemainder())
+    {
+        int a = compileExp(cexp->getLHS(), temp);
+        emit(REG_REM, dst, a, compileExp(cexp->getRemainderDivisor(), temp + 1));
+        return dst;
+    }
+    if (cexp->getOperator() == ASSIGN_OP)
+    {
+        if (cexp->getLHS()->getType() != IDENTIFIER)
+        {
+            emit(REG_BAD_ASSIGN, dst);
+            return dst;
+        }
+        int r = compileExp(cexp->getRHS(), temp);
+        int slot = ((IdentifierExp *)cexp->getLHS())->getSlot();
+        if (slot < reservedCount)
+        {
+            emit(REG_BAD_STORE, 0);
+            return r;
+        }
+        emit(REG_STORE, slot, r);
+        return slot;
+    }
+    int a = compileExp(cexp->getLHS(), temp);
+    if (a >= 0 && a < variableCount && assigns(cexp->getRHS(), a))
+    {
+        emit(REG_MOVE, dst, a);
+        a = dst;
+    }
+    int b = compileExp(cexp->getRHS(), temp + 1);
+    switch (cexp->getOperator())
+    {
+    case ADD_OP:
+        emit(REG_ADD, dst, a, b);
+        break;
+    case SUB_OP:
+        emit(REG_SUB, dst, a, b);
+        break;
+    case MUL_OP:
+        emit(REG_MUL, dst, a, b);
+        break;
+    case DIV_OP:
+        emit(cexp->isDivisorNonzero() ? REG_DIV_NONZERO : REG_DIV, dst, a, b);
+        break;
+    default:
+        emit(REG_BAD_OP, dst);
+    }
+    return dst;
+}
+
+int RegisterCode::addConstant(int value)
+{
+    map<int, int>::iterator it = constantRegisters.find(value);
+    if (it != constantRegisters.end())
+        return it->second;
+    constants.push_back(value);
+    int r = -(int)constants.size();
+    constantRegisters[value] = r;
+    return r;
+}
+
+void RegisterCode::emit(int op, int dst, int a, int b, int c)
+{
+    RegisterInstruction ins;
+    ins.op = op;
+    ins.dst = dst;
+    ins.a = a;
+    ins.b = b;
+    ins.c = c;
+    code.push_back(ins);
+}
+
+void RegisterCode::emitJump(int op, Statement *target, int a, int b, int c)
+{
+    PendingJump jump;
+    jump.pc = code.size();
+    jump.from = current;
+    jump.target = target;
+    jumps.push_back(jump);
+    emit(op, -1, a, b, c);
+}
+
+/*
+ * Function: assigns
+ * -----------------
+ * Returns true if evaluating exp stores into the variable in slot.
+ */
+
+static bool assigns(Expression *exp, int slot)
+{
+    if (exp->getType() != COMPOUND)
+        return false;
+    CompoundExp *cexp = (CompoundExp *)exp;
+    if (cexp->getOperator() == ASSIGN_OP && cexp->getLHS()->getType() == IDENTIFIER && ((IdentifierExp *)cexp->getLHS())->getSlot() == slot)
+        return true;
+    return assigns(cexp->getLHS(), slot) || assigns(cexp->getRHS(), slot);
+}
+
+/*
+ * Implementation notes: the RegisterMachine class
+ * -----------------------------------------------
+ * The register file is allocated once per program; run loads the
+ * variables and constants into it and stores the defined variables
+ * back into the EvalState when the program halts.
+ */
+
+RegisterMachine::RegisterMachine(RegisterCode &code) : code(code)
+{
+    registers.resize(code.variableCount + code.temporaryCount + code.constants.size());
+    defined.resize(code.variableCount);
+}
+
+void RegisterMachine::run(EvalState &state, int pc)
+{
+    int variableCount = code.variableCount;
+    for (int i = 0; i < variableCount; i++)
+    {
+        defined[i] = state.isDefined(i);
+        registers[i] = defined[i] ? state.getValue(i) : 0;
+    }
+    int constantBase = variableCount + code.temporaryCount;
+    for (int i = 0; i < code.constants.size(); i++)
+        registers[constantBase + i] = code.constants[i];
+
+    RegisterInstruction *program = &code.code[0];
+    RegisterInstruction *ip = program + pc;
+    int *r = &registers[0];
+    int flag = 1;
+    while (true)
+    {
+        switch (ip->op)
+        {
+        case REG_ADD:
+            r[ip->dst] = r[ip->a] + r[ip->b];
+            break;
+        case REG_SUB:
+            r[ip->dst] = r[ip->a] - r[ip->b];
+            break;
+        case REG_MUL:
+            r[ip->dst] = r[ip->a] * r[ip->b];
+            break;
+        case REG_DIV:
+            if (r[ip->b] == 0)
+            {
+                cout << "DIVIDE BY ZERO\n";
+                r[ip->dst] = 0;
+                flag = 0;
+                break;
+            }
+            r[ip->dst] = r[ip->a] / r[ip->b];
+            flag = 1;
+            break;
+        case REG_DIV_NONZERO:
+            r[ip->dst] = r[ip->a] / r[ip->b];
+            flag = 1;
+            break;
+        case REG_REM:
+            if (r[ip->b] == 0)
+            {
+                cout << "DIVIDE BY ZERO\n";
+                r[ip->dst] = r[ip->a];
+            }
+            else
+                r[ip->dst] = r[ip->a] % r[ip->b];
+            flag = 1;
+            break;
+        case REG_MOVE:
+            r[ip->dst] = r[ip->a];
+            break;
+        case REG_STORE:
+            r[ip->dst] = r[ip->a];
+            defined[ip->dst] = true;
+            break;
+        case REG_BAD_STORE:
+            cout << "SYNTAX ERROR\n";
+            break;
+        case REG_CHECK:
+            flag = defined[ip->dst];
+            if (!flag)
+                cout << "VARIABLE NOT DEFINED\n";
+            break;
+        case REG_BAD_ASSIGN:
+        case REG_BAD_OP:
+            cout << "SYNTAX ERROR\n";
+            r[ip->dst] = 0;
+            flag = 0;
+            break;
+        case REG_PRINT:
+            cout << r[ip->a] << endl;
+            break;
+        case REG_PRINT_FLAG:
+            if (flag)
+                cout << r[ip->a] << endl;
+            break;
+        case REG_INPUT:
+        {
+            int value = readInputValue();
+            if (ip->dst < code.reservedCount)
+            {
+                cout << "SYNTAX ERROR\n";
+                break;
+            }
+            r[ip->dst] = value;
+            defined[ip->dst] = true;
+            break;
+        }
+        case REG_ABS:
+            if (r[ip->dst] < 0)
+                r[ip->dst] = 0 - r[ip->dst];
+            break;
+        case REG_MAX:
+            if (r[ip->a] > r[ip->dst])
+                r[ip->dst] = r[ip->a];
+            break;
+        case REG_MIN:
+            if (r[ip->a] < r[ip->dst])
+                r[ip->dst] = r[ip->a];
+            break;
+        case REG_GCD:
+            if (r[ip->a] != 0)
+            {
+                while (r[ip->a] != 0)
+                {
+                    int t = r[ip->dst] % r[ip->a];
+                    r[ip->dst] = r[ip->a];
+                    r[ip->a] = t;
+                }
+                r[ip->b] = 0;
+                defined[ip->b] = true;
+            }
+            break;
+        case REG_CLOSED_FORM:
+        {
+            ClosedForm *form = code.closedForms[ip->dst];
+            vector<int> &slots = form->getSlots();
+            vector<int> values(slots.size());
+            int i = 0;
+            for (; i < slots.size() && defined[slots[i]]; i++)
+                values[i] = r[slots[i]];
+            if (i == slots.size() && form->advance(values))
+            {
+                for (i = 0; i < slots.size(); i++)
+                    r[slots[i]] = values[i];
+            }
+            break;
+        }
+        case REG_JUMP:
+            ip = program + ip->dst;
+            continue;
+        case REG_JUMP_GT:
+            if (r[ip->a] > r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_JUMP_LT:
+            if (r[ip->a] < r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_JUMP_EQ:
+            if (r[ip->a] == r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_LOOP_GT:
+            r[ip->a] += r[ip->c];
+            if (r[ip->a] > r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_LOOP_LT:
+            r[ip->a] += r[ip->c];
+            if (r[ip->a] < r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_LOOP_EQ:
+            r[ip->a] += r[ip->c];
+            if (r[ip->a] == r[ip->b])
+            {
+                ip = program + ip->dst;
+                continue;
+            }
+            break;
+        case REG_BAD_CMP:
+            cout << "SYNTAX ERROR" << endl;
+            break;
+        case REG_LINE_ERROR:
+            cout << "LINE NUMBER ERROR" << endl;
+            break;
+        case REG_NOT_COMPOUND:
+            cout << "Compund expression expected" << endl;
+            break;
+        case REG_HALT:
+            for (int i = 0; i < variableCount; i++)
+            {
+                if (defined[i])
+                    state.setValue(i, registers[i]);
+            }
+            return;
+        }
+        ip++;
+    }
+}
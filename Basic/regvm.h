@@ -0,0 +1,211 @@
+/*
+ * File: regvm.h
+ * -------------
+ * This interface exports a register-based backend: a compiler that
+ * lowers the parsed statements of a Program into three-address code,
+ * and the RegisterMachine that executes it.
+ */
+
+#ifndef _regvm_h
+#define _regvm_h
+
+#include "evalstate.h"
+#include "exp.h"
+#include "loops.h"
+#include "program.h"
+#include "statement.h"
+#include <map>
+#include <vector>
+using namespace std;
+
+/*
+ * Type: RegisterOpcode
+ * --------------------
+ * This enumerated type lists the instructions of the register machine.
+ * Operands are register numbers.  The first registers hold the BASIC
+ * variables, one per slot of the SymbolTable, followed by registers
+ * preloaded with the constants of the program and by temporaries.
+ *
+ *  REG_ADD d, a, b     -- d = a + b (likewise SUB and MUL)
+ *  REG_DIV d, a, b     -- d = a / b, or report DIVIDE BY ZERO
+ *  REG_DIV_NONZERO d, a, b -- d = a / b for b known not to be zero
+ *  REG_REM d, a, b     -- d = a - a / b * b, or report DIVIDE BY ZERO
+ *                         and set d = a
+ *  REG_MOVE d, a       -- d = a, used to save a variable to a temporary
+ *                         and to fill the hidden slot of a hoisted expression
+ *  REG_STORE v, a      -- assign a to variable v
+ *  REG_BAD_STORE       -- report SYNTAX ERROR for an assignment to a keyword
+ *  REG_CHECK v         -- report VARIABLE NOT DEFINED unless v is defined
+ *  REG_BAD_ASSIGN d    -- report SYNTAX ERROR for "=" without a variable
+ *  REG_BAD_OP d        -- report SYNTAX ERROR for an unknown operator
+ *  REG_PRINT a         -- print a
+ *  REG_PRINT_FLAG a    -- print a if the flag register is set
+ *  REG_INPUT v         -- read an integer from the user into v
+ *  REG_ABS v           -- v = the absolute value of v
+ *  REG_MAX v, a        -- v = a if a > v (likewise MIN with a < v)
+ *  REG_GCD v, w, t     -- run Euclid's algorithm on v and w, leaving the
+ *                         last remainder in t if it ran
+ *  REG_CLOSED_FORM k   -- run closed form k on the variables
+ *  REG_JUMP pc         -- continue execution at pc
+ *  REG_JUMP_GT pc, a, b -- jump to pc if a > b (likewise LT and EQ)
+ *  REG_LOOP_GT pc, a, b, c -- a = a + c, then jump to pc if a > b
+ *                         (likewise LT and EQ), for a counted loop
+ *  REG_BAD_CMP         -- report SYNTAX ERROR for an unknown comparison
+ *  REG_LINE_ERROR      -- report LINE NUMBER ERROR
+ *  REG_NOT_COMPOUND    -- report that LET expects a compound expression
+ *  REG_HALT            -- stop the program
+ */
+
+enum RegisterOpcode
+{
+  REG_ADD,
+  REG_SUB,
+  REG_MUL,
+  REG_DIV,
+  REG_DIV_NONZERO,
+  REG_REM,
+  REG_MOVE,
+  REG_STORE,
+  REG_BAD_STORE,
+  REG_CHECK,
+  REG_BAD_ASSIGN,
+  REG_BAD_OP,
+  REG_PRINT,
+  REG_PRINT_FLAG,
+  REG_INPUT,
+  REG_ABS,
+  REG_MAX,
+  REG_MIN,
+  REG_GCD,
+  REG_CLOSED_FORM,
+  REG_JUMP,
+  REG_JUMP_GT,
+  REG_JUMP_LT,
+  REG_JUMP_EQ,
+  REG_LOOP_GT,
+  REG_LOOP_LT,
+  REG_LOOP_EQ,
+  REG_BAD_CMP,
+  REG_LINE_ERROR,
+  REG_NOT_COMPOUND,
+  REG_HALT
+};
+
+/*
+ * Type: RegisterInstruction
+ * -------------------------
+ * A three-address instruction.  For jumps, dst holds the target.  Only
+ * the counted-loop instructions use the fourth operand c.
+ */
+
+struct RegisterInstruction
+{
+  int op;
+  int dst;
+  int a;
+  int b;
+  int c;
+};
+
+/*
+ * Class: RegisterCode
+ * -------------------
+ * This class stores a program compiled for the register machine.
+ */
+
+class RegisterCode
+{
+
+public:
+  /*
+ * Constructor: RegisterCode
+ * Usage: RegisterCode code(program, loops);
+ * -----------------------
+ * Compiles every line of the program, linking it first if needed.  If
+ * loops is not NULL, its closed forms run and the expressions it
+ * hoisted and the products it strength reduced are computed in the
+ * preheaders of their loops, and its counted loops are closed by a
+ * single REG_LOOP instruction.
+ */
+
+  RegisterCode(Program &program, LoopInvariants *loops = NULL);
+
+  /*
+ * Method: getLineAddress
+ * Usage: int pc = code.getLineAddress(line);
+ * -----------------------
+ * Returns the address of the first instruction of a line, or -1 if
+ * the line was not compiled.
+ */
+
+  int getLineAddress(int line);
+
+private:
+  int compileExp(Expression *exp, int temp);
+  int compileCompound(CompoundExp *cexp, int temp);
+  int addConstant(int value);
+  void compileStatement(Statement *stmt);
+  void compileCountedLoop(Statement *increment, ControlIF *test);
+  void emit(int op, int dst, int a = 0, int b = 0, int c = 0);
+  void emitJump(int op, Statement *target, int a = 0, int b = 0, int c = 0);
+
+  struct PendingJump
+  {
+    int pc;
+    Statement *from;
+    Statement *target;
+  };
+
+  vector<RegisterInstruction> code;
+  vector<int> constants;
+  vector<ClosedForm *> closedForms;
+  map<int, int> constantRegisters;
+  map<int, int> lines;
+  vector<PendingJump> jumps;
+  int variableCount;
+  int reservedCount;
+  int temporaryCount;
+  Statement *current;
+  LoopInvariants *loops;
+
+  friend class RegisterMachine;
+  friend class NativeCode;
+};
+
+/*
+ * Class: RegisterMachine
+ * ----------------------
+ * This class executes RegisterCode.  The variable registers are loaded
+ * from the EvalState when the program starts and written back when it
+ * stops, so the machine itself never goes through the EvalState.
+ */
+
+class RegisterMachine
+{
+
+public:
+  /*
+ * Constructor: RegisterMachine
+ * Usage: RegisterMachine machine(code);
+ * -----------------------
+ * Creates a machine for the compiled program.
+ */
+
+  RegisterMachine(RegisterCode &code);
+
+  /*
+ * Method: run
+ * Usage: machine.run(state, pc);
+ * -----------------------
+ * Executes instructions starting at pc until REG_HALT is reached.
+ */
+
+  void run(EvalState &state, int pc);
+
+private:
+  RegisterCode &code;
+  vector<int> registers;
+  vector<bool> defined;
+};
+
+#endif
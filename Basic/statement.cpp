@@ -8,13 +8,86 @@
  */
 
 #include "statement.h"
+#include "bytecode.h"
+#include "cfg.h"
+#include "compiler.h"
+#include "copies.h"
+#include "defined.h"
+#include "idiom.h"
+#include "jit.h"
+#include "loops.h"
 #include "program.h"
+#include "range.h"
+#include "regvm.h"
+#include "vm.h"
 #include <set>
+#include <sstream>
 #include <string>
 using namespace std;
 
 /* Implementation of the Statement class */
 
+/*
+ * Implementation notes: the Statement class
+ * ----------------------------------------------
+ * The base class keeps the links computed by Program::link, so that
+ * running a program only follows pointers from one statement to the
+ * next instead of looking line numbers up in the program.
+ */
+
+Statement *Statement::step(EvalState &state)
+{
+    execute(state);
+    return next;
+}
+
+Statement *Statement::getNext()
+{
+    return next;
+}
+
+void Statement::setNext(Statement *next)
+{
+    this->next = next;
+}
+
+int Statement::getLineNumber()
+{
+    return lineNumber;
+}
+
+void Statement::setLineNumber(int lineNumber)
+{
+    this->lineNumber = lineNumber;
+}
+
+/*
+ * Implementation notes: new and delete
+ * ------------------------------------
+ * These work as they do for Expression: the arena destroys the
+ * statement through destroy, and the plain delete only exists for the
+ * virtual destructor.
+ */
+
+void *Statement::operator new(size_t size, Arena &arena)
+{
+    return arena.allocate(size, destroy);
+}
+
+void Statement::operator delete(void *ptr, Arena &arena)
+{
+    arena.release(ptr);
+}
+
+void Statement::operator delete(void *ptr)
+{
+}
+
+void Statement::destroy(void *ptr)
+{
+    ((Statement *)ptr)->~Statement();
+}
+
 /*
  * Implementation notes: the SeqREM
  * ----------------------------------------------
@@ -35,16 +108,13 @@ StatementType SeqREM::getType()
 SeqLET::SeqLET(Expression *exp)
 {
     this->exp = exp;
-}
-
-SeqLET::~SeqLET()
-{
-    if (!exp)
-        delete exp;
+    dead = false;
 }
 
 void SeqLET::execute(EvalState &state)
 {
+    if (dead)
+        return;
     if (exp->getType() != COMPOUND)
     {
         cout << "Compund expression expected" << endl;
@@ -58,6 +128,21 @@ StatementType SeqLET::getType()
     return LET;
 }
 
+Expression *SeqLET::getExp()
+{
+    return exp;
+}
+
+void SeqLET::setDead(bool dead)
+{
+    this->dead = dead;
+}
+
+bool SeqLET::isDead()
+{
+    return dead;
+}
+
 /*
  * Implementation notes: the SeqPRINT subclass
  * ----------------------------------------------
@@ -69,12 +154,6 @@ SeqPRINT::SeqPRINT(Expression *exp)
     this->exp = exp;
 }
 
-SeqPRINT::~SeqPRINT()
-{
-    if (!exp)
-        delete exp;
-}
-
 void SeqPRINT::execute(EvalState &state)
 {
     int flag;
@@ -89,18 +168,39 @@ StatementType SeqPRINT::getType()
     return PRINT;
 }
 
+Expression *SeqPRINT::getExp()
+{
+    return exp;
+}
+
 /*
  * Implementation notes: the SeqINPUT subclass
  * ----------------------------------------------
  * The SeqINPUT subclass helps to set a new variable.
  */
 
-SeqINPUT::SeqINPUT(string var)
+SeqINPUT::SeqINPUT(string var, int slot)
 {
     this->var = var;
+    this->slot = slot;
 }
 
 void SeqINPUT::execute(EvalState &state)
+{
+    state.setValue(slot, readInputValue());
+}
+
+string SeqINPUT::getVarName()
+{
+    return var;
+}
+
+int SeqINPUT::getSlot()
+{
+    return slot;
+}
+
+int readInputValue()
 {
     int value;
     while (true)
@@ -119,7 +219,7 @@ void SeqINPUT::execute(EvalState &state)
         cout << "INVALID NUMBER\n";
         cin.clear();
     }
-    state.setValue(var, value);
+    return value;
 }
 
 StatementType SeqINPUT::getType()
@@ -134,6 +234,11 @@ StatementType SeqINPUT::getType()
  * reaches its end.
  */
 
+Statement *SeqEND::step(EvalState &state)
+{
+    return NULL;
+}
+
 StatementType SeqEND::getType()
 {
     return END;
@@ -150,17 +255,30 @@ ControlGOTO::ControlGOTO(int line, Program *program)
 {
     this->line = line;
     this->p = program;
+    this->target = NULL;
+}
+
+void ControlGOTO::execute(EvalState &state)
+{
+    p->setexecuteLine(line);
 }
 
-ControlGOTO::~ControlGOTO()
+Statement *ControlGOTO::step(EvalState &state)
 {
-    if (!p)
-        delete p;
+    if (target != NULL)
+        return target;
+    cout << "LINE NUMBER ERROR" << endl;
+    return next;
 }
 
-void ControlGOTO::execute(EvalState &state)
+Statement *ControlGOTO::getTarget()
 {
-    p->setexecuteLine(line);
+    return target;
+}
+
+void ControlGOTO::setTarget(Statement *target)
+{
+    this->target = target;
 }
 
 StatementType ControlGOTO::getType()
@@ -168,6 +286,11 @@ StatementType ControlGOTO::getType()
     return GOTO;
 }
 
+int ControlGOTO::getTargetLine()
+{
+    return line;
+}
+
 /*
  * Implementation notes: the SeqIF subclass
  * ----------------------------------------------
@@ -182,13 +305,8 @@ ControlIF::ControlIF(char cmp, Expression *lhs, Expression *rhs, int line, Progr
     this->rhs = rhs;
     this->line = line;
     this->p = p;
-}
-
-ControlIF::~ControlIF()
-{
-    delete lhs;
-    delete rhs;
-    delete p;
+    this->target = NULL;
+    idiom.type = NO_IDIOM;
 }
 
 void ControlIF::executeLine(int line)
@@ -197,6 +315,27 @@ void ControlIF::executeLine(int line)
 }
 
 void ControlIF::execute(EvalState &state)
+{
+    if (test(state))
+        executeLine(line);
+}
+
+Statement *ControlIF::step(EvalState &state)
+{
+    if (idiom.type != NO_IDIOM)
+    {
+        runIdiom(state);
+        return target;
+    }
+    if (!test(state))
+        return next;
+    if (target != NULL)
+        return target;
+    cout << "LINE NUMBER ERROR" << endl;
+    return next;
+}
+
+bool ControlIF::test(EvalState &state)
 {
     int flag;
     int left = lhs->eval(state, flag);
@@ -205,20 +344,89 @@ void ControlIF::execute(EvalState &state)
     switch (cmp)
     {
     case '>':
-        if (left > right)
-            executeLine(line);
-        break;
+        return left > right;
     case '<':
-        if (left < right)
-            executeLine(line);
-        break;
+        return left < right;
     case '=':
-        if (left == right)
-            executeLine(line);
-        break;
+        return left == right;
     default:
         cout << "SYNTAX ERROR" << endl;
     }
+    return false;
+}
+
+Statement *ControlIF::getTarget()
+{
+    return target;
+}
+
+void ControlIF::setTarget(Statement *target)
+{
+    this->target = target;
+}
+
+void ControlIF::setIdiom(const Idiom &idiom)
+{
+    this->idiom = idiom;
+}
+
+Idiom &ControlIF::getIdiom()
+{
+    return idiom;
+}
+
+/*
+ * Implementation notes: runIdiom
+ * ------------------------------
+ * The variables of an idiom are proven defined and its operand is a
+ * constant or a proven variable, so nothing here can print.  Euclid's
+ * algorithm divides exactly as the loop it replaces does, so INT_MIN
+ * and -1 still trap.
+ */
+
+void ControlIF::runIdiom(EvalState &state)
+{
+    int flag;
+    int a = state.getValue(idiom.a);
+    switch (idiom.type)
+    {
+    case ABS_IDIOM:
+        if (a < 0)
+            state.setValue(idiom.a, 0 - a);
+        break;
+    case MAX_IDIOM:
+    {
+        int x = idiom.operand->eval(state, flag);
+        if (x > a)
+            state.setValue(idiom.a, x);
+        break;
+    }
+    case MIN_IDIOM:
+    {
+        int x = idiom.operand->eval(state, flag);
+        if (x < a)
+            state.setValue(idiom.a, x);
+        break;
+    }
+    case GCD_IDIOM:
+    {
+        int b = state.getValue(idiom.b);
+        if (b == 0)
+            break;
+        while (b != 0)
+        {
+            int t = a % b;
+            a = b;
+            b = t;
+        }
+        state.setValue(idiom.t, 0);
+        state.setValue(idiom.a, a);
+        state.setValue(idiom.b, 0);
+        break;
+    }
+    default:
+        break;
+    }
 }
 
 StatementType ControlIF::getType()
@@ -226,21 +434,36 @@ StatementType ControlIF::getType()
     return IF;
 }
 
+char ControlIF::getCmp()
+{
+    return cmp;
+}
+
+Expression *ControlIF::getLHS()
+{
+    return lhs;
+}
+
+Expression *ControlIF::getRHS()
+{
+    return rhs;
+}
+
+int ControlIF::getTargetLine()
+{
+    return line;
+}
+
 /*
  * Implementation notes: the CommandRUN subclass
  * ----------------------------------------------
  * The CommandRUN subclass helps to execute the program.
  */
 
-CommandRUN::CommandRUN(Program *program)
+CommandRUN::CommandRUN(Program *program, ExecutionMode mode)
 {
     this->p = program;
-}
-
-CommandRUN::~CommandRUN()
-{
-    if (!p)
-        delete p;
+    this->mode = mode;
 }
 
 CommandType CommandRUN::getType()
@@ -248,38 +471,115 @@ CommandType CommandRUN::getType()
     return RUN;
 }
 
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * Before any backend runs, the definedness analysis marks the variable
+ * reads that cannot fail given the variables defined right now, copy
+ * propagation redirects the reads of copies to their sources, dead-store
+ * elimination marks the assignments no one reads, the idiom recognizer fuses the patterns it depends on, the range analysis
+ * marks the divisions that cannot fail, and the loop pass hoists
+ * invariant expressions.  The marks live in the parsed
+ * expressions and are redone on every RUN.
+ */
+
 void CommandRUN::execute(EvalState &state, Program &p)
 {
     if (p.getFirstLineNumber() == -1)
         return;
-    Statement *tmp;
     int i = p.getexecuteLineNumber();
     if (i == -1)
         return;
-    tmp = p.getParsedStatement(i);
-    while (tmp->getType() != END)
+    p.link();
+    if (state.isReportingMemory())
+        p.reportMemory(cerr);
+    Statement *entry = p.getLinkedStatement(i);
+    if (entry != NULL)
     {
-        if (tmp->getType() == REM)
-        {
-            i = p.getexecuteLineNumber();
-            if (i == -1)
-            {
-                break;
-            }
-            tmp = p.getParsedStatement(i);
-            continue;
-        }
-        tmp->execute(state);
-        i = p.getexecuteLineNumber();
-        if (i == -1)
+        SymbolTable &symbols = p.getSymbolTable();
+        vector<bool> entryDefined(symbols.size());
+        vector<int> entryValues(symbols.size());
+        for (int slot = 0; slot < symbols.size(); slot++)
         {
-            break;
+            entryDefined[slot] = state.isDefined(slot);
+            if (entryDefined[slot])
+                entryValues[slot] = state.getValue(slot);
         }
-        tmp = p.getParsedStatement(i);
+        ControlFlowGraph cfg(p, entry);
+        clearCopies(cfg);
+        analyzeDefinedness(cfg, entryDefined, symbols.getReservedCount());
+        propagateCopies(cfg, symbols.size(), symbols.getReservedCount());
+        eliminateDeadStores(cfg, symbols.size(), symbols.getReservedCount());
+        IdiomRecognizer idioms(p, symbols.getReservedCount());
+        if (state.isReportingIdioms())
+            idioms.report(cerr);
+        RangeAnalysis ranges(cfg, entryDefined, entryValues, symbols.getReservedCount());
+        LoopInvariants loops(cfg, symbols);
+        if (mode == TREE_WALKER)
+            runTree(state, cfg);
+        else if (mode == REGISTER_VM)
+            runRegister(state, p, entry, loops);
+        else if (mode == NATIVE_JIT)
+            runNative(state, p, entry, loops);
+        else
+            runBytecode(state, p, entry, loops);
     }
     p.renewexecuteLine();
 }
 
+/*
+ * Implementation notes: runTree
+ * -----------------------------
+ * The tree walker executes the parsed statements a basic block at a
+ * time: each dispatch runs a whole block and picks its successor.  It
+ * is kept as the reference implementation for differential testing.
+ */
+
+void CommandRUN::runTree(EvalState &state, ControlFlowGraph &cfg)
+{
+    BasicBlock *block = cfg.getEntry();
+    while (block != NULL)
+        block = block->execute(state);
+}
+
+/*
+ * Implementation notes: runBytecode
+ * ---------------------------------
+ * The whole linked program is compiled before it starts.
+ */
+
+void CommandRUN::runBytecode(EvalState &state, Program &p, Statement *entry, LoopInvariants &loops)
+{
+    Bytecode code;
+    Compiler compiler(code);
+    compiler.compile(p, &loops);
+    VirtualMachine vm(code, mode == THREADED_VM);
+    vm.run(state, code.getLineAddress(entry->getLineNumber()));
+    if (state.isReportingSuperinstructions())
+        vm.report(cerr);
+}
+
+void CommandRUN::runRegister(EvalState &state, Program &p, Statement *entry, LoopInvariants &loops)
+{
+    RegisterCode code(p, &loops);
+    RegisterMachine machine(code);
+    machine.run(state, code.getLineAddress(entry->getLineNumber()));
+}
+
+/*
+ * Implementation notes: runNative
+ * -------------------------------
+ * The native code is generated from the register machine's code, and
+ * NativeCode falls back to the RegisterMachine where no JIT exists.
+ */
+
+void CommandRUN::runNative(EvalState &state, Program &p, Statement *entry, LoopInvariants &loops)
+{
+    RegisterCode code(p, &loops);
+    NativeCode native(code);
+    native.run(state, code.getLineAddress(entry->getLineNumber()));
+}
+
 /*
  * Implementation notes: the CommandLIST subclass
  * ----------------------------------------------
@@ -292,12 +592,6 @@ CommandLIST::CommandLIST(Program *p)
     this->p = p;
 }
 
-CommandLIST::~CommandLIST()
-{
-    if (!p)
-        delete p;
-}
-
 CommandType CommandLIST::getType()
 {
     return LIST;
@@ -325,12 +619,6 @@ void CommandLIST::execute(EvalState &state, Program &p)
  * and program.
  */
 
-CommandCLEAR::~CommandCLEAR()
-{
-    if (!p)
-        delete p;
-}
-
 CommandCLEAR::CommandCLEAR(Program *p)
 {
     this->p = p;
@@ -383,6 +671,31 @@ void CommandHELP::execute(EvalState &state, Program &p)
     cout << "-------------------------------This is a minimal BASIC interpreter-------------------------------" << endl;
     cout << "(1)Sequential Statements:\n1.REM\n2.LET\n3.PRINT\n4.INPUT\n5.END" << endl;
     cout << "(2)Control Statements:\n1.IF...THEN...\n2.GOTO" << endl;
-    cout << "(3)BASIC Interpreter:\n1.RUN\n2.LIST\n3.CLEAR\n4.QUIT\n5.HELP" << endl;
+    cout << "(3)BASIC Interpreter:\n1.RUN\n2.LIST\n3.CLEAR\n4.QUIT\n5.HELP\n6.CHECK" << endl;
     cout << "----------------------------------------Have fun with it-----------------------------------------" << endl;
+}
+
+/*
+ * Implementation notes: the CommandCHECK subclass
+ * ----------------------------------------------
+ * The CommandCHECK subclass links the program and prints the lines
+ * that link found unreachable or unresolved, in line order.
+ */
+
+CommandType CommandCHECK::getType()
+{
+    return CHECK;
+}
+
+void CommandCHECK::execute(EvalState &state, Program &p)
+{
+    if (p.getFirstLineNumber() == -1)
+        return;
+    p.link();
+    vector<int> lines = p.getUnreachableLines();
+    for (int i = 0; i < lines.size(); i++)
+        cout << "UNREACHABLE: " << p.getSourceLine(lines[i]) << endl;
+    lines = p.getUnresolvedLines();
+    for (int i = 0; i < lines.size(); i++)
+        cout << "UNRESOLVED: " << p.getSourceLine(lines[i]) << endl;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #ifndef _statement_h
 #define _statement_h
 
+#include "arena.h"
 #include "evalstate.h"
 #include "exp.h"
 #include "program.h"
@@ -32,6 +33,44 @@ enum StatementType
 };
 
 class Program;
+class ControlFlowGraph;
+class LoopInvariants;
+
+/*
+ * Type: IdiomType
+ * ---------------
+ * This enumerated type lists the statement idioms that the
+ * IdiomRecognizer replaces with a single operation.
+ */
+
+enum IdiomType
+{
+  NO_IDIOM,
+  ABS_IDIOM,
+  MAX_IDIOM,
+  MIN_IDIOM,
+  GCD_IDIOM
+};
+
+/*
+ * Type: Idiom
+ * -----------
+ * A fused operation that an IF statement performs in place of itself
+ * and the statements it jumps over, after which it always continues at
+ * its target.  ABS_IDIOM sets the variable a to its absolute value,
+ * MAX_IDIOM and MIN_IDIOM set a to the larger or the smaller of a and
+ * operand, and GCD_IDIOM runs Euclid's algorithm on a and b, leaving
+ * the last remainder in t.
+ */
+
+struct Idiom
+{
+  IdiomType type;
+  int a;
+  int b;
+  int t;
+  Expression *operand;
+};
 
 /*
  * Class: Statement
@@ -50,23 +89,37 @@ public:
   /*
  * Constructor: Statement
  * ----------------------
- * The base class constructor is empty.  Each subclass must provide
- * its own constructor.
+ * The base class constructor only clears the link fields.  Each
+ * subclass must provide its own constructor.
  */
 
-  Statement(){};
+  Statement() : next(NULL), lineNumber(-1){};
 
   /*
  * Destructor: ~Statement
- * Usage: delete stmt;
- * -------------------
+ * Usage: usually implicit
+ * -----------------------
  * The destructor deallocates the storage for this statement.
  * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting a statement.
+ * destructor is called when the arena of a line is deleted.
  */
 
   virtual ~Statement(){};
 
+  /*
+ * Operators: new, delete
+ * Usage: Statement *stmt = new (arena) SeqEND();
+ * ----------------------------------------------
+ * A program line is allocated in an Arena together with the nodes
+ * of its expressions, and the Program deletes that arena when the
+ * line goes.  Commands and immediate-mode statements live on the
+ * stack, so plain new is hidden.
+ */
+
+  static void *operator new(size_t size, Arena &arena);
+  static void operator delete(void *ptr, Arena &arena);
+  static void operator delete(void *ptr);
+
   /*
  * Method: execute
  * Usage: stmt->execute(state);
@@ -88,6 +141,48 @@ public:
  */
 
   virtual StatementType getType() = 0;
+
+  /*
+ * Method: step
+ * Usage: Statement *next = stmt->step(state);
+ * ----------------------------
+ * This method executes the statement and returns the statement that
+ * runs after it in the linked program, or NULL when the program stops.
+ * The default follows the fall-through link; END and the control
+ * statements override it.
+ */
+
+  virtual Statement *step(EvalState &state);
+
+  /*
+ * Methods: getNext, setNext
+ * Usage: Statement *next = stmt->getNext();
+ *        stmt->setNext(next);
+ * ----------------------------
+ * These methods read and write the fall-through link, which is set
+ * by Program::link to the statement on the following line.
+ */
+
+  Statement *getNext();
+  void setNext(Statement *next);
+
+  /*
+ * Methods: getLineNumber, setLineNumber
+ * Usage: int line = stmt->getLineNumber();
+ *        stmt->setLineNumber(line);
+ * ----------------------------
+ * These methods read and write the line number of the statement.
+ */
+
+  int getLineNumber();
+  void setLineNumber(int lineNumber);
+
+protected:
+  Statement *next;
+  int lineNumber;
+
+private:
+  static void destroy(void *ptr);
 };
 
 /*
@@ -102,7 +197,7 @@ class SeqREM : public Statement
 public:
   /*
  * Constructor: SeqREM
- * Usage: statement *tmp = new SeqREM();
+ * Usage: statement *tmp = new (arena) SeqREM();
  * ------------------------------------------------
  * The constructor initializes a REM statement.
  */
@@ -148,7 +243,7 @@ class SeqLET : public Statement
 public:
   /*
  * Constructor: SeqLET
- * Usage: statement *tmp = new SeqLET(exp);
+ * Usage: statement *tmp = new (arena) SeqLET(exp);
  * ------------------------------------------------
  * The constructor initializes a LET statement.
  */
@@ -157,12 +252,12 @@ public:
 
   /*
  * Destructor: ~SeqLET
- * Usage: delete exp
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this statement.  The
+ * expression belongs to the arena of the line and is not freed here.
  */
 
-  ~SeqLET();
+  ~SeqLET(){};
 
   /*
  * Method: execute
@@ -182,8 +277,31 @@ public:
 
   virtual StatementType getType();
 
+  /*
+ * Method: getExp
+ * Usage: Expression *exp = tmp.getExp();
+ * ----------------------------
+ * This method returns the expression of the statement.
+ */
+
+  Expression *getExp();
+
+  /*
+ * Methods: setDead, isDead
+ * Usage: tmp.setDead(true);
+ *        if (tmp.isDead()) . . .
+ * ----------------------------
+ * Record whether dead-store elimination has proven that the value
+ * this statement assigns is never read, in which case execute does
+ * nothing and the compilers emit no code for it.
+ */
+
+  void setDead(bool dead);
+  bool isDead();
+
 private:
   Expression *exp;
+  bool dead;
 };
 
 /*
@@ -198,7 +316,7 @@ class SeqPRINT : public Statement
 public:
   /*
  * Constructor: SeqPRINT
- * Usage: statement *tmp = new SeqLET(exp);
+ * Usage: statement *tmp = new (arena) SeqLET(exp);
  * ------------------------------------------------
  * The constructor initializes a PRINT statement.
  */
@@ -207,12 +325,12 @@ public:
 
   /*
  * Destructor: ~SeqPRINT
- * Usage: delete exp
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this statement.  The
+ * expression belongs to the arena of the line and is not freed here.
  */
 
-  ~SeqPRINT();
+  ~SeqPRINT(){};
 
   /*
  * Method: execute
@@ -232,6 +350,15 @@ public:
 
   virtual StatementType getType();
 
+  /*
+ * Method: getExp
+ * Usage: Expression *exp = tmp.getExp();
+ * ----------------------------
+ * This method returns the expression of the statement.
+ */
+
+  Expression *getExp();
+
 private:
   Expression *exp;
 };
@@ -248,12 +375,13 @@ class SeqINPUT : public Statement
 public:
   /*
  * Constructor: SeqINPUT
- * Usage: statement *tmp = new SeqLET(var);
+ * Usage: statement *tmp = new (arena) SeqINPUT(var, slot);
  * ------------------------------------------------
- * The constructor initializes a LET statement.
+ * The constructor initializes an INPUT statement for the variable
+ * var, which is stored in the specified slot.
  */
 
-  SeqINPUT(string var);
+  SeqINPUT(string var, int slot);
 
   /*
  * Destructor: ~SeqINPUT
@@ -281,6 +409,15 @@ public:
 
   string getVarName();
 
+  /*
+ * Method: getSlot
+ * Usage: tmp.getSlot();
+ * ----------------------------
+ * This method returns the slot of the variable. 
+ */
+
+  int getSlot();
+
   /*
  * Method: getType
  * Usage: tmp.getType();
@@ -292,8 +429,19 @@ public:
 
 private:
   string var;
+  int slot;
 };
 
+/*
+ * Function: readInputValue
+ * Usage: int value = readInputValue();
+ * ------------------------------------
+ * Prompts the user with " ? " until a valid integer is entered and
+ * returns it.  This is shared by SeqINPUT and the bytecode VM.
+ */
+
+int readInputValue();
+
 /*
  * Class: SeqEND
  * ------------------
@@ -306,7 +454,7 @@ class SeqEND : public Statement
 public:
   /*
  * Constructor: SeqEND
- * Usage: statement *tmp = new SeqEND();
+ * Usage: statement *tmp = new (arena) SeqEND();
  * ------------------------------------------------
  * The constructor initializes a END statement.
  */
@@ -330,6 +478,15 @@ public:
 
   virtual void execute(EvalState &state){};
 
+  /*
+ * Method: step
+ * Usage: tmp.step(state);
+ * ----------------------------
+ * This method returns NULL, which stops the program.
+ */
+
+  virtual Statement *step(EvalState &state);
+
   /*
  * Method: getType
  * Usage: tmp.getType();
@@ -352,7 +509,7 @@ class ControlGOTO : public Statement
 public:
   /*
  * Constructor: ControlGOTO
- * Usage: statement *tmp = new ControlGOTO(line, p);
+ * Usage: statement *tmp = new (arena) ControlGOTO(line, p);
  * ------------------------------------------------
  * The constructor initializes a GOTO control statement.
  */
@@ -360,13 +517,13 @@ public:
   ControlGOTO(int line, Program *p);
 
   /*
- * Destructor: ~SeqEND
- * Usage: delete p
+ * Destructor: ~ControlGOTO
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this statement.  The
+ * program is only referred to, never owned.
  */
 
-  ~ControlGOTO();
+  ~ControlGOTO(){};
 
   /*
  * Method: execute
@@ -377,6 +534,16 @@ public:
 
   virtual void execute(EvalState &state);
 
+  /*
+ * Method: step
+ * Usage: tmp.step(state);
+ * ----------------------------
+ * This method returns the linked target.  If the target line does
+ * not exist, it reports LINE NUMBER ERROR and falls through.
+ */
+
+  virtual Statement *step(EvalState &state);
+
   /*
  * Method: getType
  * Usage: tmp.getType();
@@ -386,9 +553,31 @@ public:
 
   virtual StatementType getType();
 
+  /*
+ * Methods: getTarget, setTarget
+ * Usage: Statement *target = tmp.getTarget();
+ *        tmp.setTarget(target);
+ * ----------------------------
+ * These methods read and write the jump link, which Program::link
+ * sets to the statement at the target line, or NULL if there is none.
+ */
+
+  Statement *getTarget();
+  void setTarget(Statement *target);
+
+  /*
+ * Method: getTargetLine
+ * Usage: int line = tmp.getTargetLine();
+ * ----------------------------
+ * This method returns the line number the statement jumps to.
+ */
+
+  int getTargetLine();
+
 private:
   int line;
   Program *p;
+  Statement *target;
 };
 
 /*
@@ -403,22 +592,13 @@ class ControlIF : public Statement
 public:
   /*
  * Constructor: ControlIF
- * Usage: statement *tmp = new ControlIF(cmp, lhs, rhs, line, p);
+ * Usage: statement *tmp = new (arena) ControlIF(cmp, lhs, rhs, line, p);
  * ------------------------------------------------
  * The constructor initializes a IF control statement.
  */
 
   ControlIF(char cmp, Expression *lhs, Expression *rhs, int line, Program *p);
 
-  /*
- * Destructor: ~ControlIF
- * Usage: delete lhs, rhs, p
- * -------------------
- * The destructor deallocates the storage for this statement.
- */
-
-  ~ControlIF();
-
   /*
  * Method: execute
  * Usage: tmp.execute(state);
@@ -437,6 +617,50 @@ public:
 
   void executeLine(int line);
 
+  /*
+ * Method: step
+ * Usage: tmp.step(state);
+ * ----------------------------
+ * This method returns the linked target if the condition holds and
+ * the fall-through statement otherwise.
+ */
+
+  virtual Statement *step(EvalState &state);
+
+  /*
+ * Method: test
+ * Usage: if (tmp.test(state)) . . .
+ * ----------------------------
+ * This method evaluates both sides and returns the result of the
+ * comparison, reporting SYNTAX ERROR for an unknown operator.
+ */
+
+  bool test(EvalState &state);
+
+  /*
+ * Methods: getTarget, setTarget
+ * Usage: Statement *target = tmp.getTarget();
+ *        tmp.setTarget(target);
+ * ----------------------------
+ * These methods read and write the jump link set by Program::link.
+ */
+
+  Statement *getTarget();
+  void setTarget(Statement *target);
+
+  /*
+ * Methods: setIdiom, getIdiom
+ * Usage: tmp.setIdiom(idiom);
+ *        Idiom &idiom = tmp.getIdiom();
+ * ----------------------------
+ * These methods record the idiom that the IdiomRecognizer found at
+ * this statement, whose type is NO_IDIOM if there is none, and read
+ * it back.  step runs the idiom instead of the comparison.
+ */
+
+  void setIdiom(const Idiom &idiom);
+  Idiom &getIdiom();
+
   /*
  * Method: getType
  * Usage: tmp.getType();
@@ -446,12 +670,31 @@ public:
 
   virtual StatementType getType();
 
+  /*
+ * Methods: getCmp, getLHS, getRHS, getTargetLine
+ * Usage: char cmp = tmp.getCmp();
+ *        Expression *lhs = tmp.getLHS();
+ *        Expression *rhs = tmp.getRHS();
+ *        int line = tmp.getTargetLine();
+ * ----------------------------
+ * These methods return the components of the IF statement.
+ */
+
+  char getCmp();
+  Expression *getLHS();
+  Expression *getRHS();
+  int getTargetLine();
+
 private:
   char cmp;
   Expression *lhs;
   Expression *rhs;
   int line;
   Program *p;
+  Statement *target;
+  Idiom idiom;
+
+  void runIdiom(EvalState &state);
 };
 
 /*
@@ -467,7 +710,8 @@ enum CommandType
   LIST,
   CLEAR,
   QUIT,
-  HELP
+  HELP,
+  CHECK
 };
 
 class Command
@@ -517,7 +761,7 @@ public:
 };
 
 /*
- * Class: ControlIF
+ * Class: CommandRUN
  * ------------------
  * This subclass represents the RUN command.
  */
@@ -527,21 +771,22 @@ class CommandRUN : public Command
 public:
   /*
  * Constructor: CommandRUN
- * Usage: CommandRUN cmd = CommandRUN(p);
+ * Usage: CommandRUN cmd = CommandRUN(p, mode);
  * ------------------------------------------------
- * The constructor initializes a RUN command.
+ * The constructor initializes a RUN command which executes the
+ * program in the specified mode.
  */
 
-  CommandRUN(Program *p);
+  CommandRUN(Program *p, ExecutionMode mode);
 
   /*
  * Destructor: ~CommandRUN
- * Usage: delete p
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this command.  The
+ * program is only referred to, never owned.
  */
 
-  ~CommandRUN();
+  ~CommandRUN(){};
 
   /*
  * Method: execute
@@ -562,7 +807,13 @@ public:
   virtual CommandType getType();
 
 private:
+  void runTree(EvalState &state, ControlFlowGraph &cfg);
+  void runBytecode(EvalState &state, Program &program, Statement *entry, LoopInvariants &loops);
+  void runRegister(EvalState &state, Program &program, Statement *entry, LoopInvariants &loops);
+  void runNative(EvalState &state, Program &program, Statement *entry, LoopInvariants &loops);
+
   Program *p;
+  ExecutionMode mode;
 };
 
 /*
@@ -585,12 +836,12 @@ public:
 
   /*
  * Destructor: ~CommandLIST
- * Usage: delete p
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this command.  The
+ * program is only referred to, never owned.
  */
 
-  ~CommandLIST();
+  ~CommandLIST(){};
 
   /*
  * Method: execute
@@ -634,12 +885,12 @@ public:
 
   /*
  * Destructor: ~CommandCLEAR
- * Usage: delete p
  * -------------------
- * The destructor deallocates the storage for this statement.
+ * The destructor deallocates the storage for this command.  The
+ * program is only referred to, never owned.
  */
 
-  ~CommandCLEAR();
+  ~CommandCLEAR(){};
 
   /*
  * Method: execute
@@ -683,7 +934,6 @@ public:
 
   /*
  * Destructor: ~CommandQUIT
- * Usage: delete p
  * -------------------
  * The destructor deallocates the storage for this statement.
  */
@@ -754,4 +1004,50 @@ public:
   virtual CommandType getType();
 };
 
+/*
+ * Class: CommandCHECK
+ * -------------------
+ * This subclass represents the CHECK command, which reports the lines
+ * that can never run and the jumps to lines that do not exist.
+ */
+
+class CommandCHECK : public Command
+{
+public:
+  /*
+ * Constructor: CommandCHECK
+ * Usage: CommandCHECK cmd = CommandCHECK();
+ * ------------------------------------------------
+ * The constructor initializes a CHECK command.
+ */
+
+  CommandCHECK(){};
+
+  /*
+ * Destructor: ~CommandCHECK
+ * -------------------
+ * The destructor deallocates the storage for this statement.
+ */
+
+  ~CommandCHECK(){};
+
+  /*
+ * Method: execute
+ * Usage: cmd.execute(state, program);
+ * ----------------------------
+ * This method executes a CHECK command.
+ */
+
+  virtual void execute(EvalState &state, Program &program);
+
+  /*
+ * Method: getType
+ * Usage: cmd.getType();
+ * ----------------------------
+ * This method returns the type of command.
+ */
+
+  virtual CommandType getType();
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+ * File: symtab.cpp
+ * ----------------
+ * This file implements the SymbolTable class.
+ */
+
+#include "symtab.h"
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/* The key words, which occupy the first slots of every table */
+
+static const char *const KEYWORDS[] = {"REM", "LET", "PRINT", "INPUT", "END", "GOTO", "IF", "THEN", "RUN", "LIST", "CLEAR", "QUIT", "HELP"};
+static const int KEYWORD_COUNT = sizeof KEYWORDS / sizeof KEYWORDS[0];
+
+/* Implementation of the SymbolTable class */
+
+SymbolTable::SymbolTable()
+{
+    clear();
+}
+
+int SymbolTable::intern(string name)
+{
+    map<string, int>::iterator it = slots.find(name);
+    if (it != slots.end())
+        return it->second;
+    int slot = names.size();
+    names.push_back(name);
+    slots[name] = slot;
+    return slot;
+}
+
+int SymbolTable::lookup(string name)
+{
+    map<string, int>::iterator it = slots.find(name);
+    if (it == slots.end())
+        return -1;
+    return it->second;
+}
+
+string SymbolTable::getName(int slot)
+{
+    return names[slot];
+}
+
+int SymbolTable::size()
+{
+    return names.size();
+}
+
+int SymbolTable::getReservedCount()
+{
+    return KEYWORD_COUNT;
+}
+
+void SymbolTable::clear()
+{
+    slots.clear();
+    names.clear();
+    for (int i = 0; i < KEYWORD_COUNT; i++)
+        intern(KEYWORDS[i]);
+}
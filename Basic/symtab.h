@@ -0,0 +1,102 @@
+/*
+ * File: symtab.h
+ * --------------
+ * This interface exports the SymbolTable class, which numbers the
+ * variable names of a program so that they can be stored in slots.
+ */
+
+#ifndef _symtab_h
+#define _symtab_h
+
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Class: SymbolTable
+ * ------------------
+ * This class interns variable names into small integer slots.  The
+ * parser resolves every identifier through the symbol table of its
+ * program, and EvalState keeps the value of slot i at index i of a
+ * plain array.
+ *
+ * The keywords of the language are interned first, so the slots
+ * below getReservedCount() can never be assigned and a single
+ * comparison tells whether an assignment targets a keyword.
+ */
+
+class SymbolTable
+{
+
+public:
+  /*
+ * Constructor: SymbolTable
+ * Usage: SymbolTable symbols;
+ * -----------------------
+ * Creates a symbol table that holds only the keywords.
+ */
+
+  SymbolTable();
+
+  /*
+ * Method: intern
+ * Usage: int slot = symbols.intern(name);
+ * -----------------------
+ * Returns the slot of the name, allocating a new one the first time
+ * the name is seen.
+ */
+
+  int intern(std::string name);
+
+  /*
+ * Method: lookup
+ * Usage: int slot = symbols.lookup(name);
+ * -----------------------
+ * Returns the slot of the name, or -1 if it has never been interned.
+ */
+
+  int lookup(std::string name);
+
+  /*
+ * Method: getName
+ * Usage: string name = symbols.getName(slot);
+ * -----------------------
+ * Returns the name stored in the slot.
+ */
+
+  std::string getName(int slot);
+
+  /*
+ * Method: size
+ * Usage: int count = symbols.size();
+ * -----------------------
+ * Returns the number of slots in use, keywords included.
+ */
+
+  int size();
+
+  /*
+ * Method: getReservedCount
+ * Usage: if (slot < symbols.getReservedCount()) . . .
+ * -----------------------
+ * Returns the number of slots taken by keywords.
+ */
+
+  int getReservedCount();
+
+  /*
+ * Method: clear
+ * Usage: symbols.clear();
+ * -----------------------
+ * Forgets every variable, keeping only the keywords.
+ */
+
+  void clear();
+
+private:
+  map<string, int> slots;
+  vector<string> names;
+};
+
+#endif
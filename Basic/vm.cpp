@@ -0,0 +1,483 @@
+/*
+ * File: vm.cpp
+ * ------------
+ * This file implements the VirtualMachine class.
+ */
+
+#include "vm.h"
+#include "bytecode.h"
+#include "closedform.h"
+#include "evalstate.h"
+#include "statement.h"
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Implementation notes: the VirtualMachine class
+ * ----------------------------------------------
+ * The operand stack is allocated once with the depth computed by the
+ * compiler, so the main loop never has to check for overflow.
+ */
+
+VirtualMachine::VirtualMachine(Bytecode &code, bool threaded) : code(code)
+{
+    this->threaded = threaded;
+    Instruction *program = code.getInstructions();
+    cells.resize(code.size());
+    for (int i = 0; i < code.size(); i++)
+    {
+        cells[i].handler = NULL;
+        cells[i].op = program[i].op;
+        cells[i].arg = program[i].arg;
+    }
+    stack.resize(code.getMaxStackDepth() + 1);
+    fired.assign(OP_COUNT, 0);
+}
+
+void VirtualMachine::run(EvalState &state, int pc)
+{
+    if (threaded)
+        execute<true>(state, pc);
+    else
+        execute<false>(state, pc);
+}
+
+long long VirtualMachine::getFireCount(int op)
+{
+    return fired[op];
+}
+
+void VirtualMachine::report(ostream &os)
+{
+    static const char *const NAMES[] = {
+        "store constant", "increment",
+        "compare constant and jump", "compare constant and jump", "compare constant and jump",
+        "compare variable and jump", "compare variable and jump", "compare variable and jump",
+        "increment, compare constant and jump", "increment, compare constant and jump",
+        "increment, compare constant and jump", "increment, compare variable and jump",
+        "increment, compare variable and jump", "increment, compare variable and jump"};
+    static const char *const CMPS[] = {" (>)", " (<)", " (=)"};
+    for (int op = OP_STORE_CONST; op < OP_COUNT; op++)
+    {
+        if (fired[op] == 0)
+            continue;
+        os << NAMES[op - OP_STORE_CONST];
+        if (op >= OP_JUMP_GT_CONST)
+            os << CMPS[(op - OP_JUMP_GT_CONST) % 3];
+        os << ": " << fired[op] << endl;
+    }
+}
+
+/*
+ * Implementation notes: dispatch
+ * ------------------------------
+ * Every handler is both a case of the switch and a label, written
+ * TARGET(op).  The switch version returns to the switch after each
+ * instruction; the threaded version jumps to cells[pc].handler, which
+ * is filled from LABELS on the first run.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HAS_COMPUTED_GOTO 1
+#endif
+
+#define TARGET(op) \
+    case op:       \
+    L_##op:
+
+#ifdef HAS_COMPUTED_GOTO
+#define DISPATCH()               \
+    do                           \
+    {                            \
+        if (THREADED)            \
+            goto *ip->handler;   \
+        goto dispatch;           \
+    } while (0)
+#else
+#define DISPATCH() goto dispatch
+#endif
+
+#define NEXT()      \
+    do              \
+    {               \
+        ip++;       \
+        DISPATCH(); \
+    } while (0)
+
+#define JUMP(pc)              \
+    do                        \
+    {                         \
+        ip = cells + (pc);    \
+        DISPATCH();           \
+    } while (0)
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * sp points at the top value of the stack.  Every instruction that
+ * stands for an Expression::eval updates flag the same way the tree
+ * walker does: arithmetic keeps the flag of its right operand, while
+ * constants, stores and divisions set it explicitly.
+ */
+
+template <bool THREADED>
+void VirtualMachine::execute(EvalState &state, int pc)
+{
+#ifdef HAS_COMPUTED_GOTO
+    static const void *const LABELS[] = {
+        &&L_OP_CONST, &&L_OP_LOAD, &&L_OP_LOAD_DEFINED, &&L_OP_STORE, &&L_OP_BAD_ASSIGN,
+        &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_DIV_NONZERO, &&L_OP_REM, &&L_OP_BAD_OP,
+        &&L_OP_POP, &&L_OP_PRINT, &&L_OP_INPUT, &&L_OP_ABS, &&L_OP_MAX, &&L_OP_MIN, &&L_OP_GCD,
+        &&L_OP_CLOSED_FORM, &&L_OP_JUMP, &&L_OP_JUMP_GT, &&L_OP_JUMP_LT, &&L_OP_JUMP_EQ, &&L_OP_BAD_CMP,
+        &&L_OP_LINE_ERROR, &&L_OP_NOT_COMPOUND, &&L_OP_HALT, &&L_OP_STORE_CONST, &&L_OP_INC,
+        &&L_OP_JUMP_GT_CONST, &&L_OP_JUMP_LT_CONST, &&L_OP_JUMP_EQ_CONST,
+        &&L_OP_JUMP_GT_VAR, &&L_OP_JUMP_LT_VAR, &&L_OP_JUMP_EQ_VAR,
+        &&L_OP_INC_JUMP_GT_CONST, &&L_OP_INC_JUMP_LT_CONST, &&L_OP_INC_JUMP_EQ_CONST,
+        &&L_OP_INC_JUMP_GT_VAR, &&L_OP_INC_JUMP_LT_VAR, &&L_OP_INC_JUMP_EQ_VAR};
+    if (THREADED && cells[0].handler == NULL)
+    {
+        for (int i = 0; i < cells.size(); i++)
+            cells[i].handler = LABELS[cells[i].op];
+    }
+#endif
+    Cell *cells = &this->cells[0];
+    long long *fired = &this->fired[0];
+    Cell *ip = cells + pc;
+    int *sp = &stack[0] - 1;
+    int flag = 1;
+    DISPATCH();
+
+dispatch:
+    switch (ip->op)
+    {
+        TARGET(OP_CONST)
+        {
+            *++sp = ip->arg;
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_LOAD)
+        {
+            if (!state.isDefined(ip->arg))
+            {
+                cout << "VARIABLE NOT DEFINED\n";
+                *++sp = 0;
+                flag = 0;
+                NEXT();
+            }
+            *++sp = state.getValue(ip->arg);
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_LOAD_DEFINED)
+        {
+            *++sp = state.getValue(ip->arg);
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_STORE)
+        {
+            state.setValue(ip->arg, *sp);
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_BAD_ASSIGN)
+        {
+            cout << "SYNTAX ERROR\n";
+            *++sp = 0;
+            flag = 0;
+            NEXT();
+        }
+        TARGET(OP_ADD)
+        {
+            sp--;
+            *sp = *sp + sp[1];
+            NEXT();
+        }
+        TARGET(OP_SUB)
+        {
+            sp--;
+            *sp = *sp - sp[1];
+            NEXT();
+        }
+        TARGET(OP_MUL)
+        {
+            sp--;
+            *sp = *sp * sp[1];
+            NEXT();
+        }
+        TARGET(OP_DIV)
+        {
+            sp--;
+            if (sp[1] == 0)
+            {
+                cout << "DIVIDE BY ZERO\n";
+                *sp = 0;
+                flag = 0;
+                NEXT();
+            }
+            *sp = *sp / sp[1];
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_DIV_NONZERO)
+        {
+            sp--;
+            *sp = *sp / sp[1];
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_REM)
+        {
+            sp--;
+            if (sp[1] == 0)
+                cout << "DIVIDE BY ZERO\n";
+            else
+                *sp = *sp % sp[1];
+            flag = 1;
+            NEXT();
+        }
+        TARGET(OP_BAD_OP)
+        {
+            sp--;
+            cout << "SYNTAX ERROR\n";
+            *sp = 0;
+            flag = 0;
+            NEXT();
+        }
+        TARGET(OP_POP)
+        {
+            sp--;
+            NEXT();
+        }
+        TARGET(OP_PRINT)
+        {
+            if (flag)
+                cout << *sp << endl;
+            sp--;
+            NEXT();
+        }
+        TARGET(OP_INPUT)
+        {
+            state.setValue(ip->arg, readInputValue());
+            NEXT();
+        }
+        TARGET(OP_ABS)
+        {
+            int value = state.getValue(ip->arg);
+            if (value < 0)
+                state.setValue(ip->arg, 0 - value);
+            NEXT();
+        }
+        TARGET(OP_MAX)
+        {
+            if (*sp > state.getValue(ip->arg))
+                state.setValue(ip->arg, *sp);
+            sp--;
+            NEXT();
+        }
+        TARGET(OP_MIN)
+        {
+            if (*sp < state.getValue(ip->arg))
+                state.setValue(ip->arg, *sp);
+            sp--;
+            NEXT();
+        }
+        TARGET(OP_GCD)
+        {
+            if (sp[0] != 0)
+            {
+                while (sp[0] != 0)
+                {
+                    int t = sp[-1] % sp[0];
+                    sp[-1] = sp[0];
+                    sp[0] = t;
+                }
+                state.setValue(ip->arg, 0);
+            }
+            NEXT();
+        }
+        TARGET(OP_CLOSED_FORM)
+        {
+            code.getClosedForm(ip->arg)->run(state);
+            NEXT();
+        }
+        TARGET(OP_JUMP)
+        {
+            JUMP(ip->arg);
+        }
+        TARGET(OP_JUMP_GT)
+        {
+            sp -= 2;
+            if (sp[1] > sp[2])
+                JUMP(ip->arg);
+            NEXT();
+        }
+        TARGET(OP_JUMP_LT)
+        {
+            sp -= 2;
+            if (sp[1] < sp[2])
+                JUMP(ip->arg);
+            NEXT();
+        }
+        TARGET(OP_JUMP_EQ)
+        {
+            sp -= 2;
+            if (sp[1] == sp[2])
+                JUMP(ip->arg);
+            NEXT();
+        }
+        TARGET(OP_BAD_CMP)
+        {
+            sp -= 2;
+            cout << "SYNTAX ERROR" << endl;
+            NEXT();
+        }
+        TARGET(OP_LINE_ERROR)
+        {
+            cout << "LINE NUMBER ERROR" << endl;
+            NEXT();
+        }
+        TARGET(OP_NOT_COMPOUND)
+        {
+            cout << "Compund expression expected" << endl;
+            NEXT();
+        }
+        TARGET(OP_HALT)
+        {
+            return;
+        }
+        TARGET(OP_STORE_CONST)
+        {
+            fired[OP_STORE_CONST]++;
+            state.setValue(ip[1].arg, ip->arg);
+            flag = 1;
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_INC)
+        {
+            fired[OP_INC]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            ip += 5;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_GT_CONST)
+        {
+            fired[OP_JUMP_GT_CONST]++;
+            flag = 1;
+            if (state.getValue(ip->arg) > ip[1].arg)
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_LT_CONST)
+        {
+            fired[OP_JUMP_LT_CONST]++;
+            flag = 1;
+            if (state.getValue(ip->arg) < ip[1].arg)
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_EQ_CONST)
+        {
+            fired[OP_JUMP_EQ_CONST]++;
+            flag = 1;
+            if (state.getValue(ip->arg) == ip[1].arg)
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_GT_VAR)
+        {
+            fired[OP_JUMP_GT_VAR]++;
+            flag = 1;
+            if (state.getValue(ip->arg) > state.getValue(ip[1].arg))
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_LT_VAR)
+        {
+            fired[OP_JUMP_LT_VAR]++;
+            flag = 1;
+            if (state.getValue(ip->arg) < state.getValue(ip[1].arg))
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_EQ_VAR)
+        {
+            fired[OP_JUMP_EQ_VAR]++;
+            flag = 1;
+            if (state.getValue(ip->arg) == state.getValue(ip[1].arg))
+                JUMP(ip[2].arg);
+            ip += 3;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_GT_CONST)
+        {
+            fired[OP_INC_JUMP_GT_CONST]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) > ip[6].arg)
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_LT_CONST)
+        {
+            fired[OP_INC_JUMP_LT_CONST]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) < ip[6].arg)
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_EQ_CONST)
+        {
+            fired[OP_INC_JUMP_EQ_CONST]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) == ip[6].arg)
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_GT_VAR)
+        {
+            fired[OP_INC_JUMP_GT_VAR]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) > state.getValue(ip[6].arg))
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_LT_VAR)
+        {
+            fired[OP_INC_JUMP_LT_VAR]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) < state.getValue(ip[6].arg))
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+        TARGET(OP_INC_JUMP_EQ_VAR)
+        {
+            fired[OP_INC_JUMP_EQ_VAR]++;
+            state.setValue(ip->arg, state.getValue(ip->arg) + ip[1].arg);
+            flag = 1;
+            if (state.getValue(ip[5].arg) == state.getValue(ip[6].arg))
+                JUMP(ip[7].arg);
+            ip += 8;
+            DISPATCH();
+        }
+    }
+}
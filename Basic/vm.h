@@ -0,0 +1,90 @@
+/*
+ * File: vm.h
+ * ----------
+ * This interface exports the VirtualMachine class, a stack machine
+ * that executes the Bytecode produced by the Compiler.
+ */
+
+#ifndef _vm_h
+#define _vm_h
+
+#include "bytecode.h"
+#include "evalstate.h"
+#include <iostream>
+#include <vector>
+using namespace std;
+
+/*
+ * Class: VirtualMachine
+ * ---------------------
+ * This class runs a compiled program against an EvalState.  Besides
+ * the operand stack, the VM keeps a flag register which mirrors the
+ * flag argument of Expression::eval and decides whether PRINT shows
+ * its value.
+ *
+ * The VM has two dispatch loops built from the same handlers: a
+ * portable switch, and a direct-threaded loop in which every
+ * instruction holds the address of its handler and jumps straight to
+ * the next one with a computed goto.  The threaded loop needs the
+ * labels-as-values extension of GCC and Clang; other compilers fall
+ * back to the switch.
+ */
+
+class VirtualMachine
+{
+
+public:
+  /*
+ * Constructor: VirtualMachine
+ * Usage: VirtualMachine vm(code, threaded);
+ * -----------------------
+ * Creates a VM for the compiled program.  If threaded is true, the VM
+ * uses the direct-threaded dispatch loop.
+ */
+
+  VirtualMachine(Bytecode &code, bool threaded = false);
+
+  /*
+ * Method: run
+ * Usage: vm.run(state, pc);
+ * -----------------------
+ * Executes instructions starting at pc until OP_HALT is reached.
+ */
+
+  void run(EvalState &state, int pc);
+
+  /*
+ * Methods: getFireCount, report
+ * Usage: long long count = vm.getFireCount(OP_INC);
+ *        vm.report(cerr);
+ * -----------------------
+ * Tell how many times each superinstruction has run on this VM.
+ * report writes one line per superinstruction that fired.
+ */
+
+  long long getFireCount(int op);
+  void report(ostream &os);
+
+private:
+  template <bool THREADED>
+  void execute(EvalState &state, int pc);
+
+  /*
+   * Each Cell is an Instruction together with the address of the
+   * code that executes it, filled in on the first threaded run.
+   */
+  struct Cell
+  {
+    const void *handler;
+    int op;
+    int arg;
+  };
+
+  Bytecode &code;
+  bool threaded;
+  vector<Cell> cells;
+  vector<int> stack;
+  vector<long long> fired;
+};
+
+#endif
@@ -29,6 +29,16 @@ TokenScanner::TokenScanner(istream & infile) {
 
 TokenScanner::~TokenScanner() {
    if (stringInputFlag) delete isp;
+   while (savedTokens != NULL) {
+      StringCell *cp = savedTokens;
+      savedTokens = cp->link;
+      delete cp;
+   }
+   while (operators != NULL) {
+      StringCell *cp = operators;
+      operators = cp->link;
+      delete cp;
+   }
 }
 
 void TokenScanner::setInput(string str) {
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Measures the cost of one executed BASIC statement in every execution
+ * mode of the interpreter.  Each workload is a loop whose number of
+ * executed statements is known exactly; it is run with n and 2n
+ * iterations and the difference of the two times is divided by the
+ * difference of the two statement counts, so that start-up, parsing
+ * and compilation cancel out.
+ */
+
+const string defaultStudentBasic = "../Basic/Basic";
+const string benchFile = "bench_prog.txt";
+
+struct Workload {
+  string name;
+  int perIteration;   // statements executed by one iteration
+  const char *text;   // program, with %N for the iteration count
+};
+
+const Workload workloads[] = {
+  { "loop", 2,
+    "10 LET i = 0\n"
+    "20 LET i = i + 1\n"
+    "30 IF i < %N THEN 20\n"
+    "40 PRINT i\n" },
+  { "arith", 4,
+    "10 LET i = 0\n"
+    "20 LET s = 0\n"
+    "30 LET i = i + 1\n"
+    "40 LET t = i - i / 7 * 7\n"
+    "50 LET s = s + t * 2\n"
+    "60 IF i < %N THEN 30\n"
+    "70 PRINT s\n" },
+  { "goto", 5,
+    "10 LET i = 0\n"
+    "20 GOTO 40\n"
+    "30 IF i < %N THEN 20\n"
+    "35 END\n"
+    "40 REM skip\n"
+    "50 LET i = i + 1\n"
+    "60 GOTO 30\n" },
+};
+const int workloadCount = sizeof workloads / sizeof workloads[0];
+
+const string defaultModes[] = { "tree", "vm", "threaded", "register", "jit" };
+const int defaultModeCount = sizeof defaultModes / sizeof defaultModes[0];
+
+string studentBasic = "";
+long iterations = 1000000;
+int repeats = 3;
+
+void useage(const char* progname) {
+  cout
+    << progname << " [-h] [-e <your_exec>] [-n <iterations>] [-r <repeats>] [mode ...]" << endl
+    << "    -h  Show this message and quit" << endl
+    << "    -e  Specify your executable file, default value: " << defaultStudentBasic << endl
+    << "    -n  Iterations of the shorter run, default value: " << iterations << endl
+    << "    -r  Runs per measurement (the fastest is kept), default value: " << repeats << endl
+    << "    mode  Execution modes to compare, default: tree vm threaded register jit" << endl
+  ;
+  exit(1);
+}
+
+string program(const Workload &w, long n) {
+  string text = w.text;
+  ostringstream count;
+  count << n;
+  size_t pos = text.find("%N");
+  text.replace(pos, 2, count.str());
+  return text + "RUN\nQUIT\n";
+}
+
+double now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double timeRun(const string &mode, const Workload &w, long n) {
+  ofstream out(benchFile.c_str());
+  out << program(w, n);
+  out.close();
+  string cmd = "cat " + benchFile + " | " + studentBasic + " --mode " + mode + " > /dev/null 2> /dev/null";
+  double best = -1;
+  for (int i = 0; i < repeats; i++) {
+    double start = now();
+    if (system(cmd.c_str()) != 0) return -1;
+    double elapsed = now() - start;
+    if (best < 0 || elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+int main(int argc, char** argv) {
+  int c;
+  opterr = 0;
+  while ((c = getopt (argc, argv, "e:n:r:h")) != -1) {
+    switch (c)
+    {
+      case 'e': studentBasic = optarg; break;
+      case 'n': iterations = atol(optarg); break;
+      case 'r': repeats = atoi(optarg); break;
+      default: useage(argv[0]); break;
+    }
+  }
+  if (studentBasic.size() == 0) studentBasic = defaultStudentBasic;
+  if (iterations <= 0 || repeats <= 0) useage(argv[0]);
+
+  vector<string> modes(argv + optind, argv + argc);
+  if (modes.empty()) modes.assign(defaultModes, defaultModes + defaultModeCount);
+
+  cout << "workload  mode        ns/statement" << endl;
+  for (int i = 0; i < workloadCount; i++) {
+    for (size_t j = 0; j < modes.size(); j++) {
+      double t1 = timeRun(modes[j], workloads[i], iterations);
+      double t2 = timeRun(modes[j], workloads[i], 2 * iterations);
+      cout.width(10); cout << left << workloads[i].name;
+      cout.width(12); cout << left << modes[j];
+      if (t1 < 0 || t2 < 0) cout << "failed" << endl;
+      else cout << (t2 - t1) * 1e9 / (workloads[i].perIteration * iterations) << endl;
+    }
+  }
+  int r = system(("rm -f " + benchFile).c_str());
+  (void)r;
+  return 0;
+}
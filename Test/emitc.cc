@@ -0,0 +1,180 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Checks the C translation of "Basic --emit-c" against the interpreter
+ * on the trace corpus.  For every trace, the numbered lines before the
+ * first RUN are the program and the lines right after it are the
+ * answers to its INPUT statements.  The program is translated, compiled
+ * with the C compiler, and run on the answers; its output must equal
+ * what the interpreter prints for that RUN.  Traces without a program,
+ * or whose RUN does not finish, are skipped.
+ */
+
+const string traceFolder = "../Test/trace/";
+const string defaultStudentBasic = "../Basic/Basic";
+const string defaultCompiler = "cc -O2";
+const int traceCount = 100;
+
+string studentBasic = "";
+string compiler = "";
+string traceFile = "";
+bool hideError = false;
+
+int correct = 0, wrong = 0, skipped = 0;
+
+void useage(const char* progname) {
+  cout
+    << progname << " [-h] [-e <your_exec>] [-c <c_compiler>] [-t <trace_file>] [-m]" << endl
+    << "    -h  Show this message and quit" << endl
+    << "    -e  Specify your executable file, default value: " << defaultStudentBasic << endl
+    << "    -c  Specify the C compiler command, default value: " << defaultCompiler << endl
+    << "    -t  Run specified trace file" << endl
+    << "    -m  Hide error message" << endl
+  ;
+  exit(1);
+}
+
+string firstWord(const string &line) {
+  istringstream in(line);
+  string word;
+  in >> word;
+  return word;
+}
+
+bool isLineNumber(const string &word) {
+  return word.size() > 0 && word.find_first_not_of("0123456789") == string::npos;
+}
+
+bool isCommand(const string &line) {
+  const string commands[] = { "RUN", "LIST", "CLEAR", "QUIT", "HELP", "LET", "PRINT", "INPUT" };
+  string word = firstWord(line);
+  for (int i = 0; i < 8; i++)
+    if (word == commands[i]) return true;
+  if (!isLineNumber(word)) return false;
+  string rest = line.substr(line.find(word) + word.size());
+  return rest.find_first_not_of(" \t") != string::npos;
+}
+
+string readFile(const string &name) {
+  ifstream in(name.c_str());
+  ostringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+void writeFile(const string &name, const string &text) {
+  ofstream out(name.c_str());
+  out << text;
+}
+
+int run(const string &cmd) {
+  return system(cmd.c_str());
+}
+
+void clearTempFiles() {
+  run("rm -f emitc_prog.bas emitc_prog.c emitc_prog emitc_load.txt emitc_full.txt emitc_input.txt emitc_load emitc_full emitc_out");
+}
+
+/*
+ * Returns 0 on success, 1 if the trace was skipped and 2 if the output
+ * of the translation differs from the interpreter's.
+ */
+int testTrace(const string &trace, string &message) {
+  ifstream in(trace.c_str());
+  vector<string> lines;
+  string line;
+  while (getline(in, line)) lines.push_back(line);
+
+  size_t runLine = 0;
+  while (runLine < lines.size() && firstWord(lines[runLine]) != "RUN") runLine++;
+  string program, inputs;
+  for (size_t i = 0; i < runLine; i++)
+    if (isLineNumber(firstWord(lines[i]))) program += lines[i] + "\n";
+  for (size_t i = runLine + 1; i < lines.size() && !isCommand(lines[i]); i++)
+    inputs += lines[i] + "\n";
+  if (runLine == lines.size() || program.empty()) {
+    message = "no program";
+    return 1;
+  }
+
+  writeFile("emitc_prog.bas", program + "RUN\n");
+  writeFile("emitc_load.txt", program + "QUIT\n");
+  writeFile("emitc_full.txt", program + "RUN\n" + inputs + "QUIT\n");
+  writeFile("emitc_input.txt", inputs);
+  if (run("cat emitc_load.txt | timeout 1 " + studentBasic + " > emitc_load 2> /dev/null") != 0 ||
+      run("cat emitc_full.txt | timeout 1 " + studentBasic + " > emitc_full 2> /dev/null") != 0) {
+    message = "interpreter did not finish";
+    return 1;
+  }
+  if (run(studentBasic + " --emit-c emitc_prog.bas > emitc_prog.c 2> /dev/null") != 0) {
+    message = "--emit-c failed";
+    return 2;
+  }
+  if (run(compiler + " -o emitc_prog emitc_prog.c") != 0) {
+    message = "the translation does not compile";
+    return 2;
+  }
+  if (run("timeout 1 ./emitc_prog < emitc_input.txt > emitc_out 2> /dev/null") != 0) {
+    message = "the translation did not finish";
+    return 2;
+  }
+  string expected = readFile("emitc_full"), loaded = readFile("emitc_load"), actual = readFile("emitc_out");
+  if (expected.compare(0, loaded.size(), loaded) != 0 || expected.substr(loaded.size()) != actual) {
+    message = "Interpreter output:\n" + expected.substr(loaded.size()) + "\nTranslation output:\n" + actual;
+    return 2;
+  }
+  return 0;
+}
+
+void runTest(const string &trace) {
+  cout << "Trace \"" << trace << "\" ... "; cout.flush();
+  string message;
+  int result = testTrace(trace, message);
+  if (result == 0) {
+    cout << "Pass" << endl;
+    correct++;
+  } else if (result == 1) {
+    cout << "Skip (" << message << ")" << endl;
+    skipped++;
+  } else {
+    cout << "Fail" << endl;
+    if (!hideError) cout << message << endl;
+    wrong++;
+  }
+  clearTempFiles();
+}
+
+int main(int argc, char** argv) {
+  int c;
+  opterr = 0;
+  while ((c = getopt (argc, argv, "e:c:t:mh")) != -1) {
+    switch (c)
+    {
+      case 'e': studentBasic = optarg; break;
+      case 'c': compiler = optarg; break;
+      case 't': traceFile = optarg; break;
+      case 'm': hideError = true; break;
+      default: useage(argv[0]); break;
+    }
+  }
+  if (studentBasic.size() == 0) studentBasic = defaultStudentBasic;
+  if (compiler.size() == 0) compiler = defaultCompiler;
+
+  if (traceFile.size()) runTest(traceFile);
+  else {
+    for (int i = 0; i < traceCount; i++) {
+      ostringstream name;
+      name << traceFolder << "trace" << (i < 10 ? "0" : "") << i << ".txt";
+      runTest(name.str());
+    }
+  }
+  cout << "Passed: " << correct << "  Failed: " << wrong << "  Skipped: " << skipped << endl;
+  return wrong == 0 ? 0 : 1;
+}